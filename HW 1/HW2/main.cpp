@@ -34,6 +34,7 @@ int main(void)
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	glfwSwapInterval(1);
 	glewExperimental = true;
 	if (glewInit() != GLEW_OK) {
 		fprintf(stderr, "Failed to initialize GLEW\n");
@@ -82,19 +83,32 @@ int main(void)
 	GLfloat angle = 0.0f;
 	GLfloat w = 0.01f;
 
+	// The angle still steps by w 30 times a second, frames show it between the last two steps.
+	const double tick = 1.0 / 30.0;
+	double accumulator = 0.0;
+	double previous_time = glfwGetTime();
+	GLfloat previous_angle = angle;
+
 	do {
-		Sleep(1000 / 30);
+		double current_time = glfwGetTime();
+		// A long stall is not caught up, that would only stall again.
+		accumulator += current_time - previous_time > 0.25 ? 0.25 : current_time - previous_time;
+		previous_time = current_time;
+		while (accumulator >= tick) {
+			previous_angle = angle;
+			angle += w;
+			accumulator -= tick;
+		}
+		GLfloat shown_angle = previous_angle + (angle - previous_angle) * GLfloat(accumulator / tick);
 
 		glClear(GL_COLOR_BUFFER_BIT);
 
 		glm::mat4 View = glm::lookAt(
-			glm::vec3(0.0f, r * std::cos(angle), r * std::sin(angle)),
+			glm::vec3(0.0f, r * std::cos(shown_angle), r * std::sin(shown_angle)),
 			glm::vec3(0, 0, 0),
 			glm::vec3(0, 1, 0)
 		);
 
-		angle += w;
-
 		glm::mat4 MVP = Projection * View * Model;
 
 		glEnableVertexAttribArray(0);
@@ -38,6 +38,7 @@ int main(void)
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	glfwSwapInterval(1);
 
 	glewExperimental = true;
 	if (glewInit() != GLEW_OK) {
@@ -118,8 +119,23 @@ int main(void)
 	GLfloat w = 0.03f;
 	GLfloat angle = 0.0f;
 
+	// The angle still steps by w 30 times a second, frames show it between the last two steps.
+	const double tick = 1.0 / 30.0;
+	double accumulator = 0.0;
+	double previous_time = glfwGetTime();
+	GLfloat previous_angle = angle;
+
 	do {
-		Sleep(1000 / 30);
+		double current_time = glfwGetTime();
+		// A long stall is not caught up, that would only stall again.
+		accumulator += current_time - previous_time > 0.25 ? 0.25 : current_time - previous_time;
+		previous_time = current_time;
+		while (accumulator >= tick) {
+			previous_angle = angle;
+			angle += w;
+			accumulator -= tick;
+		}
+		GLfloat shown_angle = previous_angle + (angle - previous_angle) * GLfloat(accumulator / tick);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		glUseProgram(programID);
@@ -132,9 +148,7 @@ int main(void)
 		glBindBuffer(GL_ARRAY_BUFFER, colorbuffer);
 		glVertexAttribPointer(1, 3,	GL_FLOAT, GL_FALSE,	0, (void*)0);
 
-		glm::mat4 Model = glm::rotate(angle, glm::vec3(1.0f, 0.0f, 0.0f));
-
-		angle += w;
+		glm::mat4 Model = glm::rotate(shown_angle, glm::vec3(1.0f, 0.0f, 0.0f));
 
 		glm::mat4 MVP = Projection * View * Model;
 		glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
@@ -0,0 +1,97 @@
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include <cfloat>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+// Axis aligned box used by all collision structures.
+// A default constructed box is empty: growing it by anything yields that thing.
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	AABB() = default;
+	AABB(const glm::vec3& lower, const glm::vec3& upper) : min(lower), max(upper) {}
+
+	static AABB FromSphere(const glm::vec3& center, float radius) {
+		glm::vec3 r(radius, radius, radius);
+		return AABB(center - r, center + r);
+	}
+
+	bool Empty() const {
+		return min.x > max.x || min.y > max.y || min.z > max.z;
+	}
+
+	void Grow(const glm::vec3& point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void Grow(const AABB& box) {
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	glm::vec3 Center() const {
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 Extent() const {
+		return max - min;
+	}
+
+	float SurfaceArea() const {
+		if (Empty()) {
+			return 0.0f;
+		}
+		glm::vec3 e = Extent();
+		return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+	}
+
+	bool Overlaps(const AABB& box) const {
+		return min.x <= box.max.x && max.x >= box.min.x &&
+			min.y <= box.max.y && max.y >= box.min.y &&
+			min.z <= box.max.z && max.z >= box.min.z;
+	}
+
+	bool Contains(const AABB& box) const {
+		return min.x <= box.min.x && min.y <= box.min.y && min.z <= box.min.z &&
+			max.x >= box.max.x && max.y >= box.max.y && max.z >= box.max.z;
+	}
+
+	// Squared distance from the point to the box, zero inside.
+	float DistanceSquared(const glm::vec3& point) const {
+		glm::vec3 d = glm::max(min - point, glm::max(point - max, glm::vec3(0.0f, 0.0f, 0.0f)));
+		return glm::dot(d, d);
+	}
+
+	bool OverlapsSphere(const glm::vec3& center, float radius) const {
+		return DistanceSquared(center) <= radius * radius;
+	}
+
+	// Slab test. inv_direction is 1 / direction per component (infinities are fine).
+	// On hit t_enter holds the entry distance clamped to zero.
+	bool Raycast(const glm::vec3& origin, const glm::vec3& inv_direction, float max_t, float& t_enter) const {
+		float t0 = 0.0f;
+		float t1 = max_t;
+		for (int axis = 0; axis < 3; ++axis) {
+			float near_t = (min[axis] - origin[axis]) * inv_direction[axis];
+			float far_t = (max[axis] - origin[axis]) * inv_direction[axis];
+			if (near_t > far_t) {
+				std::swap(near_t, far_t);
+			}
+			// NaN from 0 * inf means the ray lies in the slab plane; keep the current range then.
+			if (near_t == near_t) t0 = std::max(t0, near_t);
+			if (far_t == far_t) t1 = std::min(t1, far_t);
+			if (t0 > t1) {
+				return false;
+			}
+		}
+		t_enter = t0;
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,403 @@
+#ifndef AABB_TREE_HPP
+#define AABB_TREE_HPP
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <cfloat>
+
+#include <glm/glm.hpp>
+
+#include "aabb.hpp"
+
+// Incrementally updated bounding volume tree for moving objects.
+// Leaves store a fattened box so small moves do not touch the tree, a leaf is
+// only reinserted once its tight box leaves the fat one. Inner nodes are kept
+// balanced with AVL rotations, insertion picks siblings by surface area cost.
+template <typename T>
+class DynamicAABBTree {
+public:
+	static const int null_node = -1;
+	// Depth first traversal keeps at most height + 1 nodes on the stack,
+	// AVL balancing bounds the height by 1.44 log2 of the leaf count.
+	static const int max_stack = 128;
+
+	explicit DynamicAABBTree(float margin = 0.5f, float displacement_multiplier = 2.0f)
+		: margin_(margin), displacement_multiplier_(displacement_multiplier) {}
+
+	int CreateProxy(const AABB& box, const T& data) {
+		int id = Allocate();
+		nodes_[id].tight = box;
+		nodes_[id].box = Fatten(box, glm::vec3(0.0f, 0.0f, 0.0f));
+		nodes_[id].data = data;
+		nodes_[id].height = 0;
+		InsertLeaf(id);
+		return id;
+	}
+
+	void DestroyProxy(int id) {
+		RemoveLeaf(id);
+		Free(id);
+	}
+
+	// Returns true if the leaf had to be reinserted.
+	bool MoveProxy(int id, const AABB& box, const glm::vec3& displacement) {
+		nodes_[id].tight = box;
+		if (nodes_[id].box.Contains(box)) {
+			return false;
+		}
+		RemoveLeaf(id);
+		nodes_[id].box = Fatten(box, displacement);
+		InsertLeaf(id);
+		return true;
+	}
+
+	void Clear() {
+		nodes_.clear();
+		root_ = null_node;
+		free_list_ = null_node;
+	}
+
+	const T& Data(int id) const { return nodes_[id].data; }
+	void SetData(int id, const T& data) { nodes_[id].data = data; }
+	const AABB& FatBox(int id) const { return nodes_[id].box; }
+	const AABB& TightBox(int id) const { return nodes_[id].tight; }
+	int Height() const { return root_ == null_node ? 0 : nodes_[root_].height; }
+
+	// Calls callback(id) for every leaf whose tight box overlaps box, stops when it returns false.
+	template <typename F>
+	void Query(const AABB& box, F&& callback) const {
+		if (root_ == null_node) {
+			return;
+		}
+		int stack[max_stack];
+		int top = 0;
+		stack[top++] = root_;
+		while (top > 0) {
+			int index = stack[--top];
+			const Node& node = nodes_[index];
+			if (!node.box.Overlaps(box)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (node.tight.Overlaps(box) && !callback(index)) {
+					break;
+				}
+			}
+			else {
+				stack[top++] = node.child1;
+				stack[top++] = node.child2;
+			}
+		}
+	}
+
+	// Leaves whose tight box touches the sphere.
+	void QueryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const {
+		if (root_ == null_node) {
+			return;
+		}
+		int stack[max_stack];
+		int top = 0;
+		stack[top++] = root_;
+		while (top > 0) {
+			int index = stack[--top];
+			const Node& node = nodes_[index];
+			if (!node.box.OverlapsSphere(center, radius)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (node.tight.OverlapsSphere(center, radius)) {
+					out.push_back(index);
+				}
+			}
+			else {
+				stack[top++] = node.child1;
+				stack[top++] = node.child2;
+			}
+		}
+	}
+
+	// Up to k leaves accepted by filter(data), nearest tight box first.
+	// Best first search: nodes are expanded by distance, so the search stops as
+	// soon as the k-th result is closer than anything left in the queue.
+	template <typename F>
+	void QueryKNearest(const glm::vec3& center, size_t k, std::vector<int>& out, F&& filter) const {
+		if (root_ == null_node || k == 0) {
+			return;
+		}
+
+		typedef std::pair<float, int> Entry;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+		std::priority_queue<Entry> best;
+
+		open.push(Entry(nodes_[root_].box.DistanceSquared(center), root_));
+		while (!open.empty()) {
+			Entry entry = open.top();
+			open.pop();
+			if (best.size() == k && entry.first > best.top().first) {
+				break;
+			}
+
+			const Node& node = nodes_[entry.second];
+			if (node.IsLeaf()) {
+				if (!filter(node.data)) {
+					continue;
+				}
+				best.push(Entry(node.tight.DistanceSquared(center), entry.second));
+				if (best.size() > k) {
+					best.pop();
+				}
+			}
+			else {
+				open.push(Entry(nodes_[node.child1].box.DistanceSquared(center), node.child1));
+				open.push(Entry(nodes_[node.child2].box.DistanceSquared(center), node.child2));
+			}
+		}
+
+		size_t first = out.size();
+		while (!best.empty()) {
+			out.push_back(best.top().second);
+			best.pop();
+		}
+		std::reverse(out.begin() + first, out.end());
+	}
+
+	// Calls callback(id, max_distance) for leaves whose tight box the ray enters.
+	// The callback returns the distance of an accepted hit, which clips the ray,
+	// or max_distance to ignore the leaf. Returns the closest accepted leaf or null_node.
+	template <typename F>
+	int Raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, F&& callback) const {
+		if (root_ == null_node) {
+			return null_node;
+		}
+
+		glm::vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		int closest = null_node;
+
+		int stack[max_stack];
+		int top = 0;
+		stack[top++] = root_;
+		while (top > 0) {
+			int index = stack[--top];
+			const Node& node = nodes_[index];
+			float t_enter;
+			if (!node.box.Raycast(origin, inv_direction, max_distance, t_enter)) {
+				continue;
+			}
+			if (node.IsLeaf()) {
+				if (!node.tight.Raycast(origin, inv_direction, max_distance, t_enter)) {
+					continue;
+				}
+				float distance = callback(index, max_distance);
+				if (distance < max_distance) {
+					max_distance = distance;
+					closest = index;
+				}
+			}
+			else {
+				stack[top++] = node.child1;
+				stack[top++] = node.child2;
+			}
+		}
+		return closest;
+	}
+
+private:
+	struct Node {
+		AABB box;
+		AABB tight;
+		T data = T();
+		// Parent for nodes in the tree, next free node for nodes in the free list.
+		int parent = null_node;
+		int child1 = null_node;
+		int child2 = null_node;
+		// Leaves have height 0, free nodes -1.
+		int height = -1;
+
+		bool IsLeaf() const { return child1 == null_node; }
+	};
+
+	AABB Fatten(const AABB& box, const glm::vec3& displacement) const {
+		glm::vec3 r(margin_, margin_, margin_);
+		AABB fat(box.min - r, box.max + r);
+		glm::vec3 d = displacement * displacement_multiplier_;
+		fat.min = glm::min(fat.min, fat.min + d);
+		fat.max = glm::max(fat.max, fat.max + d);
+		return fat;
+	}
+
+	int Allocate() {
+		if (free_list_ == null_node) {
+			nodes_.push_back(Node());
+			return int(nodes_.size()) - 1;
+		}
+		int id = free_list_;
+		free_list_ = nodes_[id].parent;
+		nodes_[id] = Node();
+		return id;
+	}
+
+	void Free(int id) {
+		nodes_[id].parent = free_list_;
+		nodes_[id].height = -1;
+		free_list_ = id;
+	}
+
+	static AABB Union(const AABB& a, const AABB& b) {
+		AABB box = a;
+		box.Grow(b);
+		return box;
+	}
+
+	void Refit(int index) {
+		Node& node = nodes_[index];
+		node.height = 1 + std::max(nodes_[node.child1].height, nodes_[node.child2].height);
+		node.box = Union(nodes_[node.child1].box, nodes_[node.child2].box);
+	}
+
+	void ReplaceChild(int parent, int old_child, int new_child) {
+		if (parent == null_node) {
+			root_ = new_child;
+		}
+		else if (nodes_[parent].child1 == old_child) {
+			nodes_[parent].child1 = new_child;
+		}
+		else {
+			nodes_[parent].child2 = new_child;
+		}
+	}
+
+	void InsertLeaf(int leaf) {
+		if (root_ == null_node) {
+			root_ = leaf;
+			nodes_[leaf].parent = null_node;
+			return;
+		}
+
+		const AABB leaf_box = nodes_[leaf].box;
+		int index = root_;
+		while (!nodes_[index].IsLeaf()) {
+			const Node& node = nodes_[index];
+			float area = node.box.SurfaceArea();
+			float combined_area = Union(node.box, leaf_box).SurfaceArea();
+
+			// Cost of making a new parent for this node and the leaf,
+			// and the cost every level below pays for the grown box.
+			float cost = 2.0f * combined_area;
+			float inheritance_cost = 2.0f * (combined_area - area);
+
+			float child_costs[2];
+			int children[2] = { node.child1, node.child2 };
+			for (int c = 0; c < 2; ++c) {
+				const Node& child = nodes_[children[c]];
+				float grown = Union(child.box, leaf_box).SurfaceArea();
+				child_costs[c] = (child.IsLeaf() ? grown : grown - child.box.SurfaceArea()) + inheritance_cost;
+			}
+
+			if (cost < child_costs[0] && cost < child_costs[1]) {
+				break;
+			}
+			index = child_costs[0] < child_costs[1] ? node.child1 : node.child2;
+		}
+
+		int sibling = index;
+		int old_parent = nodes_[sibling].parent;
+		int new_parent = Allocate();
+		nodes_[new_parent].parent = old_parent;
+		nodes_[new_parent].box = Union(leaf_box, nodes_[sibling].box);
+		nodes_[new_parent].height = nodes_[sibling].height + 1;
+		nodes_[new_parent].child1 = sibling;
+		nodes_[new_parent].child2 = leaf;
+		nodes_[sibling].parent = new_parent;
+		nodes_[leaf].parent = new_parent;
+		ReplaceChild(old_parent, sibling, new_parent);
+
+		FixUpwards(nodes_[leaf].parent);
+	}
+
+	void RemoveLeaf(int leaf) {
+		if (leaf == root_) {
+			root_ = null_node;
+			return;
+		}
+
+		int parent = nodes_[leaf].parent;
+		int grand_parent = nodes_[parent].parent;
+		int sibling = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+		ReplaceChild(grand_parent, parent, sibling);
+		nodes_[sibling].parent = grand_parent;
+		Free(parent);
+
+		FixUpwards(grand_parent);
+	}
+
+	void FixUpwards(int index) {
+		while (index != null_node) {
+			index = Balance(index);
+			Refit(index);
+			index = nodes_[index].parent;
+		}
+	}
+
+	// Rotates the taller grandchild up when the children heights differ by more than one.
+	// Returns the node now at the position of a.
+	int Balance(int a) {
+		Node& node_a = nodes_[a];
+		if (node_a.IsLeaf() || node_a.height < 2) {
+			return a;
+		}
+
+		int b = node_a.child1;
+		int c = node_a.child2;
+		int balance = nodes_[c].height - nodes_[b].height;
+
+		if (balance > 1) {
+			return Rotate(a, c, false);
+		}
+		if (balance < -1) {
+			return Rotate(a, b, true);
+		}
+		return a;
+	}
+
+	// Promotes child up to the place of a. left tells which child of a it was.
+	int Rotate(int a, int up, bool left) {
+		int other = left ? nodes_[a].child2 : nodes_[a].child1;
+		int f = nodes_[up].child1;
+		int g = nodes_[up].child2;
+
+		nodes_[up].child1 = a;
+		nodes_[up].parent = nodes_[a].parent;
+		nodes_[a].parent = up;
+		ReplaceChild(nodes_[up].parent, a, up);
+
+		// The taller grandchild stays under up, the shorter one moves to a.
+		int keep = nodes_[f].height > nodes_[g].height ? f : g;
+		int move = keep == f ? g : f;
+
+		nodes_[up].child2 = keep;
+		if (left) {
+			nodes_[a].child1 = move;
+		}
+		else {
+			nodes_[a].child2 = move;
+		}
+		nodes_[move].parent = a;
+
+		nodes_[a].box = Union(nodes_[other].box, nodes_[move].box);
+		nodes_[a].height = 1 + std::max(nodes_[other].height, nodes_[move].height);
+		nodes_[up].box = Union(nodes_[a].box, nodes_[keep].box);
+		nodes_[up].height = 1 + std::max(nodes_[a].height, nodes_[keep].height);
+		return up;
+	}
+
+	std::vector<Node> nodes_;
+	int root_ = null_node;
+	int free_list_ = null_node;
+	float margin_;
+	float displacement_multiplier_;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+#include "ai_scheduler.hpp"
+
+AiScheduler::AiScheduler(float near_distance, double budget)
+	: near_distance_(near_distance), budget_(budget) {}
+
+int AiScheduler::Period(float distance, bool visible) const {
+	int period = 1;
+	for (float band = near_distance_; distance > band && period < max_period; band *= 2.0f) {
+		period *= 2;
+	}
+	if (!visible && period < max_period) {
+		period *= 2;
+	}
+	return period;
+}
+
+size_t AiScheduler::Allowed() const {
+	if (cost_ <= 0.0 || std::isinf(budget_)) {
+		return SIZE_MAX;
+	}
+	// Never less than one update, so the most overdue agent always gets its turn.
+	size_t allowed = size_t(budget_ / cost_);
+	return allowed > 0 ? allowed : 1;
+}
+
+void AiScheduler::Count(int period) {
+	int slot = 0;
+	while ((1 << slot) < period && slot < 7) {
+		++slot;
+	}
+	++stats_.periods[slot];
+}
+
+void AiScheduler::EndTick(size_t updates, size_t deferred, double seconds) {
+	++stats_.ticks;
+	stats_.updates += updates;
+	stats_.deferred += deferred;
+	stats_.seconds += seconds;
+	if (updates > 0) {
+		double cost = seconds / updates;
+		cost_ = cost_ == 0.0 ? cost : cost_ * 0.9 + cost * 0.1;
+	}
+}
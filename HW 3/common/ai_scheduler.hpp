@@ -0,0 +1,57 @@
+#ifndef AI_SCHEDULER_HPP
+#define AI_SCHEDULER_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+struct AiStats {
+	uint64_t ticks = 0;
+	uint64_t updates = 0;
+	// Updates that were due but pushed to a later tick by the budget.
+	uint64_t deferred = 0;
+	// Agents seen per update period, period 1 << i in slot i.
+	uint64_t periods[8] = {};
+	double seconds = 0.0;
+};
+
+// Level of detail for AI. Agents near the viewer think every tick, the period doubles
+// each time the distance does and once more out of view. Every agent has a fixed
+// phase, an agent with period p thinks on the ticks where (tick + phase) % p == 0, so
+// the agents of one period are spread evenly over its ticks. A time budget per tick
+// caps the updates, the measured cost of one update tells how many fit. An infinite
+// budget never defers, for sessions that must replay the same.
+class AiScheduler {
+public:
+	static const int max_period = 8;
+
+	AiScheduler(float near_distance, double budget);
+
+	int Period(float distance, bool visible) const;
+
+	static uint32_t Phase(uint32_t id) {
+		return (id * 2654435761u) >> 29;
+	}
+
+	static bool Due(uint64_t tick, uint32_t phase, int period) {
+		return (tick + phase) % uint64_t(period) == 0;
+	}
+
+	// Updates that fit into the budget this tick.
+	size_t Allowed() const;
+
+	// Counts an agent with this period, for the statistics.
+	void Count(int period);
+
+	void EndTick(size_t updates, size_t deferred, double seconds);
+
+	const AiStats& Stats() const { return stats_; }
+
+private:
+	float near_distance_;
+	double budget_;
+	// Running average of one update in seconds, zero until measured.
+	double cost_ = 0.0;
+	AiStats stats_;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef BEHAVIOUR_HPP
+#define BEHAVIOUR_HPP
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <cstddef>
+
+#include "object_pool.hpp"
+
+// Script of an agent written as a coroutine that runs one think at a time. Resume runs it
+// up to its next co_await Behaviour::Next(), the locals it keeps between thinks live in the
+// coroutine frame instead of a hand written state machine. Frames come from a pool, so
+// starting a behaviour doesn't touch the heap once the pool has warmed up.
+class Behaviour {
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> Coroutine;
+
+	struct promise_type {
+		// Thinks still to sleep through before the coroutine runs on.
+		int sleep = 0;
+
+		Behaviour get_return_object() { return Behaviour(Coroutine::from_promise(*this)); }
+		// Nothing runs until the first think.
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void* operator new(size_t size) { return Frames().Allocate(size); }
+		static void operator delete(void* frame, size_t size) { Frames().Free(frame, size); }
+	};
+
+	// Ends the current think, the behaviour goes on after sleeping through thinks - 1 more.
+	struct Yield {
+		int thinks;
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(Coroutine coroutine) const noexcept { coroutine.promise().sleep = thinks - 1; }
+		void await_resume() const noexcept {}
+	};
+
+	static Yield Next(int thinks = 1) { return Yield{ thinks }; }
+
+	Behaviour() = default;
+
+	Behaviour(Behaviour&& behaviour) noexcept : coroutine_(std::exchange(behaviour.coroutine_, nullptr)) {}
+
+	Behaviour& operator=(Behaviour&& behaviour) noexcept {
+		if (this != &behaviour) {
+			Reset();
+			coroutine_ = std::exchange(behaviour.coroutine_, nullptr);
+		}
+		return *this;
+	}
+
+	Behaviour(const Behaviour&) = delete;
+	Behaviour& operator=(const Behaviour&) = delete;
+
+	~Behaviour() { Reset(); }
+
+	// Runs one think, a sleeping behaviour only counts it.
+	void Resume() {
+		if (!coroutine_ || coroutine_.done()) {
+			return;
+		}
+		if (coroutine_.promise().sleep > 0) {
+			--coroutine_.promise().sleep;
+			return;
+		}
+		coroutine_.resume();
+	}
+
+	bool Running() const { return coroutine_ && !coroutine_.done(); }
+
+	void Reset() {
+		if (coroutine_) {
+			coroutine_.destroy();
+			coroutine_ = nullptr;
+		}
+	}
+
+	// Frames of all behaviours, shared by the threads that think.
+	static SizeClassPool& Frames() {
+		static SizeClassPool pool;
+		return pool;
+	}
+
+private:
+	explicit Behaviour(Coroutine coroutine) : coroutine_(coroutine) {}
+
+	Coroutine coroutine_ = nullptr;
+};
+
+#endif
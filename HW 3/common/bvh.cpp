@@ -0,0 +1,327 @@
+#include <vector>
+#include <future>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "bvh.hpp"
+
+static const int sah_bins = 12;
+static const uint32_t max_leaf_triangles = 4;
+static const float traversal_cost = 1.0f;
+// Traversal stacks hold this many nodes. Nodes at depth max_depth - 1 are leaves whatever they
+// hold, and a visit pops one node and pushes two, so no stack grows past it.
+static const int max_depth = 64;
+
+// Real-Time Collision Detection, 5.1.5
+static glm::vec3 ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	glm::vec3 ab = b - a;
+	glm::vec3 ac = c - a;
+	glm::vec3 ap = p - a;
+	float d1 = glm::dot(ab, ap);
+	float d2 = glm::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+	glm::vec3 bp = p - b;
+	float d3 = glm::dot(ab, bp);
+	float d4 = glm::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	glm::vec3 cp = p - c;
+	float d5 = glm::dot(ab, cp);
+	float d6 = glm::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Moller-Trumbore, double sided.
+static bool RayTriangle(const glm::vec3& origin, const glm::vec3& direction,
+	const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& t) {
+	glm::vec3 e1 = b - a;
+	glm::vec3 e2 = c - a;
+	glm::vec3 p = glm::cross(direction, e2);
+	float det = glm::dot(e1, p);
+	if (std::abs(det) < 1e-8f) {
+		return false;
+	}
+	float inv_det = 1.0f / det;
+	glm::vec3 s = origin - a;
+	float u = glm::dot(s, p) * inv_det;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	glm::vec3 q = glm::cross(s, e1);
+	float v = glm::dot(direction, q) * inv_det;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	t = glm::dot(e2, q) * inv_det;
+	return t >= 0.0f;
+}
+
+void TriangleBVH::Build(const std::vector<glm::vec3>& vertices) {
+	triangles_.clear();
+	nodes_.clear();
+
+	size_t count = vertices.size() / 3;
+	if (count == 0) {
+		return;
+	}
+
+	triangles_.reserve(count);
+	std::vector<glm::vec3> centroids;
+	centroids.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		Triangle tri = { vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2] };
+		triangles_.push_back(tri);
+		centroids.push_back((tri.a + tri.b + tri.c) / 3.0f);
+	}
+
+	nodes_.reserve(2 * count);
+	Node root;
+	root.first = 0;
+	root.count = uint32_t(count);
+	nodes_.push_back(root);
+	Subdivide(0, 0, centroids);
+	nodes_.shrink_to_fit();
+}
+
+std::future<TriangleBVH> TriangleBVH::BuildAsync(std::vector<glm::vec3> vertices) {
+	return std::async(std::launch::async, [vertices = std::move(vertices)]() {
+		TriangleBVH bvh;
+		bvh.Build(vertices);
+		return bvh;
+	});
+}
+
+void TriangleBVH::Subdivide(uint32_t node_index, int depth, std::vector<glm::vec3>& centroids) {
+	uint32_t first = nodes_[node_index].first;
+	uint32_t count = nodes_[node_index].count;
+
+	AABB box;
+	AABB centroid_box;
+	for (uint32_t i = first; i < first + count; ++i) {
+		box.Grow(triangles_[i].a);
+		box.Grow(triangles_[i].b);
+		box.Grow(triangles_[i].c);
+		centroid_box.Grow(centroids[i]);
+	}
+	nodes_[node_index].box = box;
+
+	if (count <= max_leaf_triangles || depth >= max_depth - 1) {
+		return;
+	}
+
+	// Pick the cheapest bin boundary over all three axes.
+	int best_axis = -1;
+	int best_split = 0;
+	float best_cost = FLT_MAX;
+	glm::vec3 extent = centroid_box.Extent();
+
+	for (int axis = 0; axis < 3; ++axis) {
+		if (extent[axis] <= 0.0f) {
+			continue;
+		}
+
+		AABB bin_boxes[sah_bins];
+		uint32_t bin_counts[sah_bins] = {};
+		float scale = sah_bins / extent[axis];
+
+		for (uint32_t i = first; i < first + count; ++i) {
+			int bin = std::min(sah_bins - 1, int((centroids[i][axis] - centroid_box.min[axis]) * scale));
+			++bin_counts[bin];
+			bin_boxes[bin].Grow(triangles_[i].a);
+			bin_boxes[bin].Grow(triangles_[i].b);
+			bin_boxes[bin].Grow(triangles_[i].c);
+		}
+
+		float left_area[sah_bins - 1];
+		uint32_t left_count[sah_bins - 1];
+		AABB left_box;
+		uint32_t left_sum = 0;
+		for (int i = 0; i < sah_bins - 1; ++i) {
+			left_box.Grow(bin_boxes[i]);
+			left_sum += bin_counts[i];
+			left_area[i] = left_box.SurfaceArea();
+			left_count[i] = left_sum;
+		}
+
+		AABB right_box;
+		uint32_t right_sum = 0;
+		for (int i = sah_bins - 1; i > 0; --i) {
+			right_box.Grow(bin_boxes[i]);
+			right_sum += bin_counts[i];
+			float cost = left_count[i - 1] * left_area[i - 1] + right_sum * right_box.SurfaceArea();
+			if (left_count[i - 1] > 0 && right_sum > 0 && cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_split = i;
+			}
+		}
+	}
+
+	float leaf_cost = count * box.SurfaceArea();
+	if (best_axis < 0 || traversal_cost * box.SurfaceArea() + best_cost >= leaf_cost) {
+		return;
+	}
+
+	float scale = sah_bins / extent[best_axis];
+	uint32_t i = first;
+	uint32_t j = first + count - 1;
+	while (i <= j) {
+		int bin = std::min(sah_bins - 1, int((centroids[i][best_axis] - centroid_box.min[best_axis]) * scale));
+		if (bin < best_split) {
+			++i;
+		}
+		else {
+			std::swap(triangles_[i], triangles_[j]);
+			std::swap(centroids[i], centroids[j]);
+			if (j == 0) break;
+			--j;
+		}
+	}
+
+	uint32_t left_count = i - first;
+	if (left_count == 0 || left_count == count) {
+		return;
+	}
+
+	uint32_t left_index = uint32_t(nodes_.size());
+	Node left;
+	left.first = first;
+	left.count = left_count;
+	Node right;
+	right.first = i;
+	right.count = count - left_count;
+	nodes_.push_back(left);
+	nodes_.push_back(right);
+
+	nodes_[node_index].first = left_index;
+	nodes_[node_index].count = 0;
+
+	Subdivide(left_index, depth + 1, centroids);
+	Subdivide(left_index + 1, depth + 1, centroids);
+}
+
+bool TriangleBVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const {
+	if (nodes_.empty()) {
+		return false;
+	}
+
+	glm::vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float closest = max_distance;
+	bool found = false;
+
+	uint32_t stack[max_depth];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const Node& node = nodes_[stack[--top]];
+		float t_enter;
+		if (!node.box.Raycast(origin, inv_direction, closest, t_enter)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				const Triangle& tri = triangles_[i];
+				float t;
+				if (RayTriangle(origin, direction, tri.a, tri.b, tri.c, t) && t <= closest) {
+					closest = t;
+					found = true;
+					hit.distance = t;
+					hit.triangle = i;
+					hit.normal = glm::normalize(glm::cross(tri.b - tri.a, tri.c - tri.a));
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is likely culled by closest.
+		uint32_t left = node.first;
+		uint32_t right = node.first + 1;
+		float left_t = 0.0f;
+		float right_t = 0.0f;
+		bool left_hit = nodes_[left].box.Raycast(origin, inv_direction, closest, left_t);
+		bool right_hit = nodes_[right].box.Raycast(origin, inv_direction, closest, right_t);
+		if (left_hit && right_hit) {
+			if (right_t < left_t) {
+				std::swap(left, right);
+			}
+			stack[top++] = right;
+			stack[top++] = left;
+		}
+		else if (left_hit) {
+			stack[top++] = left;
+		}
+		else if (right_hit) {
+			stack[top++] = right;
+		}
+	}
+
+	if (found) {
+		hit.point = origin + direction * hit.distance;
+		if (glm::dot(hit.normal, direction) > 0.0f) {
+			hit.normal = -hit.normal;
+		}
+	}
+	return found;
+}
+
+bool TriangleBVH::OverlapSphere(const glm::vec3& center, float radius, glm::vec3* closest_point) const {
+	if (nodes_.empty()) {
+		return false;
+	}
+
+	float radius_squared = radius * radius;
+
+	uint32_t stack[max_depth];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const Node& node = nodes_[stack[--top]];
+		if (!node.box.OverlapsSphere(center, radius)) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				const Triangle& tri = triangles_[i];
+				glm::vec3 p = ClosestPointOnTriangle(center, tri.a, tri.b, tri.c);
+				glm::vec3 d = p - center;
+				if (glm::dot(d, d) <= radius_squared) {
+					if (closest_point != nullptr) {
+						*closest_point = p;
+					}
+					return true;
+				}
+			}
+		}
+		else {
+			stack[top++] = node.first;
+			stack[top++] = node.first + 1;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,63 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <vector>
+#include <future>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "aabb.hpp"
+
+struct RayHit {
+	float distance;
+	glm::vec3 point;
+	glm::vec3 normal;
+	uint32_t triangle;
+};
+
+// Bounding volume hierarchy over a static triangle soup, built with the binned
+// surface area heuristic. Triangles are taken as consecutive vertex triples, the
+// same layout LoadedModel feeds to glDrawArrays(GL_TRIANGLES, ...).
+class TriangleBVH {
+public:
+	TriangleBVH() = default;
+
+	void Build(const std::vector<glm::vec3>& vertices);
+
+	// Builds on a worker thread, the vertices are copied so the caller may keep using them.
+	static std::future<TriangleBVH> BuildAsync(std::vector<glm::vec3> vertices);
+
+	bool Empty() const { return nodes_.empty(); }
+	size_t TriangleCount() const { return triangles_.size(); }
+	AABB Bounds() const { return nodes_.empty() ? AABB() : nodes_[0].box; }
+
+	// Closest hit along the ray within max_distance, direction must be normalized.
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const;
+
+	// True if any triangle touches the sphere, closest_point gets the nearest point on that triangle.
+	bool OverlapSphere(const glm::vec3& center, float radius, glm::vec3* closest_point = nullptr) const;
+
+private:
+	struct Triangle {
+		glm::vec3 a;
+		glm::vec3 b;
+		glm::vec3 c;
+	};
+
+	// Leaves have count > 0 and own triangles [first, first + count),
+	// inner nodes keep their children at first and first + 1.
+	struct Node {
+		AABB box;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	// depth of the node, the root is 0.
+	void Subdivide(uint32_t node_index, int depth, std::vector<glm::vec3>& centroids);
+
+	std::vector<Triangle> triangles_;
+	std::vector<Node> nodes_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "ccd.hpp"
+
+bool SweepSpheres(
+	const glm::vec3& a, const glm::vec3& a_move,
+	const glm::vec3& b, const glm::vec3& b_move,
+	float radius, float& toi
+){
+	// Work in the frame of b: a moves along d from s, solve |s + d t| = radius.
+	glm::vec3 s = a - b;
+	glm::vec3 d = a_move - b_move;
+
+	float c = glm::dot(s, s) - radius * radius;
+	if (c <= 0.0f) {
+		return false;
+	}
+
+	float dd = glm::dot(d, d);
+	float sd = glm::dot(s, d);
+	if (dd <= 0.0f || sd >= 0.0f) {
+		// Not moving or moving apart.
+		return false;
+	}
+
+	float discriminant = sd * sd - dd * c;
+	if (discriminant < 0.0f) {
+		return false;
+	}
+
+	float t = (-sd - std::sqrt(discriminant)) / dd;
+	if (t < 0.0f || t > 1.0f) {
+		return false;
+	}
+
+	toi = t;
+	return true;
+}
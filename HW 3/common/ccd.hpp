@@ -0,0 +1,16 @@
+#ifndef CCD_HPP
+#define CCD_HPP
+
+#include <glm/glm.hpp>
+
+// Continuous collision of two spheres moving linearly during one step.
+// a and b are the centers at the start of the step, a_move and b_move their displacements,
+// radius the sum of both radii. On hit toi is the first time of contact in [0, 1].
+// Spheres that already touch at the start are not reported, the discrete test handles them.
+bool SweepSpheres(
+	const glm::vec3& a, const glm::vec3& a_move,
+	const glm::vec3& b, const glm::vec3& b_move,
+	float radius, float& toi
+);
+
+#endif
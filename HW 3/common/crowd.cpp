@@ -0,0 +1,131 @@
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "crowd.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define CROWD_SSE2
+#include <emmintrin.h>
+#endif
+
+static const uint32_t min_buckets = 16;
+
+static inline void PushScalar(const float* x, const float* z, const float* radius, const float* weight,
+	size_t first, size_t end, float px, float pz, float reach, float& sum_x, float& sum_z) {
+	for (size_t k = first; k < end; ++k) {
+		float dx = px - x[k];
+		float dz = pz - z[k];
+		float d2 = dx * dx + dz * dz;
+		float r = reach + radius[k];
+		if (d2 > 0.0f && d2 < r * r) {
+			float d = std::sqrt(d2);
+			float w = (r - d) / (r * d) * weight[k];
+			sum_x += dx * w;
+			sum_z += dz * w;
+		}
+	}
+}
+
+void CrowdGrid::Build(const CrowdSoA& crowd, float spacing) {
+	spacing_ = spacing;
+	float max_radius = 0.0f;
+	for (float r : crowd.radius) {
+		max_radius = std::max(max_radius, r);
+	}
+	cell_size_ = std::max(2.0f * max_radius + spacing, 1e-3f);
+
+	uint32_t buckets = min_buckets;
+	while (buckets < 2 * crowd.Size()) {
+		buckets *= 2;
+	}
+	mask_ = buckets - 1;
+
+	// Counting sort by bucket, members of one bucket keep their order.
+	std::vector<uint32_t> bucket(crowd.Size());
+	bucket_start_.assign(buckets + 1, 0);
+	for (size_t i = 0; i < crowd.Size(); ++i) {
+		bucket[i] = Bucket(int(std::floor(crowd.x[i] / cell_size_)), int(std::floor(crowd.z[i] / cell_size_)));
+		++bucket_start_[bucket[i] + 1];
+	}
+	for (uint32_t b = 0; b < buckets; ++b) {
+		bucket_start_[b + 1] += bucket_start_[b];
+	}
+
+	x_.resize(crowd.Size());
+	z_.resize(crowd.Size());
+	radius_.resize(crowd.Size());
+	weight_.resize(crowd.Size());
+	std::vector<uint32_t> next(bucket_start_.begin(), bucket_start_.end() - 1);
+	for (size_t i = 0; i < crowd.Size(); ++i) {
+		uint32_t slot = next[bucket[i]]++;
+		x_[slot] = crowd.x[i];
+		z_[slot] = crowd.z[i];
+		radius_[slot] = crowd.radius[i];
+		weight_[slot] = crowd.weight[i];
+	}
+}
+
+uint32_t CrowdGrid::Bucket(int x, int z) const {
+	return (uint32_t(x) * 73856093u ^ uint32_t(z) * 19349663u) & mask_;
+}
+
+glm::vec3 CrowdGrid::Separation(const glm::vec3& position, float radius) const {
+	if (x_.empty()) {
+		return glm::vec3(0.0f);
+	}
+	int cell_x = int(std::floor(position.x / cell_size_));
+	int cell_z = int(std::floor(position.z / cell_size_));
+	float reach = radius + spacing_;
+
+	// Cells may share a bucket, each bucket is visited once.
+	uint32_t visited[9];
+	int count = 0;
+	float sum_x = 0.0f;
+	float sum_z = 0.0f;
+	for (int dz = -1; dz <= 1; ++dz) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			uint32_t b = Bucket(cell_x + dx, cell_z + dz);
+			if (std::find(visited, visited + count, b) != visited + count) {
+				continue;
+			}
+			visited[count++] = b;
+
+			size_t k = bucket_start_[b];
+			size_t end = bucket_start_[b + 1];
+#ifdef CROWD_SSE2
+			__m128 px = _mm_set1_ps(position.x);
+			__m128 pz = _mm_set1_ps(position.z);
+			__m128 reach4 = _mm_set1_ps(reach);
+			__m128 zero = _mm_setzero_ps();
+			__m128 lanes_x = zero;
+			__m128 lanes_z = zero;
+			for (; k + 4 <= end; k += 4) {
+				__m128 ddx = _mm_sub_ps(px, _mm_loadu_ps(&x_[k]));
+				__m128 ddz = _mm_sub_ps(pz, _mm_loadu_ps(&z_[k]));
+				__m128 d2 = _mm_add_ps(_mm_mul_ps(ddx, ddx), _mm_mul_ps(ddz, ddz));
+				__m128 r = _mm_add_ps(reach4, _mm_loadu_ps(&radius_[k]));
+				__m128 inside = _mm_and_ps(_mm_cmpgt_ps(d2, zero), _mm_cmplt_ps(d2, _mm_mul_ps(r, r)));
+				__m128 d = _mm_sqrt_ps(d2);
+				// Lanes outside are masked after the division, whatever it made of them.
+				__m128 w = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(r, d), _mm_mul_ps(r, d)), _mm_loadu_ps(&weight_[k]));
+				w = _mm_and_ps(inside, w);
+				lanes_x = _mm_add_ps(lanes_x, _mm_mul_ps(ddx, w));
+				lanes_z = _mm_add_ps(lanes_z, _mm_mul_ps(ddz, w));
+			}
+			float out_x[4];
+			float out_z[4];
+			_mm_storeu_ps(out_x, lanes_x);
+			_mm_storeu_ps(out_z, lanes_z);
+			sum_x += (out_x[0] + out_x[1]) + (out_x[2] + out_x[3]);
+			sum_z += (out_z[0] + out_z[1]) + (out_z[2] + out_z[3]);
+#endif
+			PushScalar(x_.data(), z_.data(), radius_.data(), weight_.data(), k, end,
+				position.x, position.z, reach, sum_x, sum_z);
+		}
+	}
+	return glm::vec3(sum_x, 0.0f, sum_z);
+}
@@ -0,0 +1,63 @@
+#ifndef CROWD_HPP
+#define CROWD_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Circles in the ground plane that keep their distance, one array per component.
+// Weight scales how hard a member pushes others away.
+struct CrowdSoA {
+	std::vector<float> x;
+	std::vector<float> z;
+	std::vector<float> radius;
+	std::vector<float> weight;
+
+	void Clear() {
+		x.clear();
+		z.clear();
+		radius.clear();
+		weight.clear();
+	}
+
+	void Push(const glm::vec3& position, float r, float w) {
+		x.push_back(position.x);
+		z.push_back(position.z);
+		radius.push_back(r);
+		weight.push_back(w);
+	}
+
+	size_t Size() const {
+		return x.size();
+	}
+};
+
+// Uniform grid over a crowd, hashed into a table sized by the crowd so it covers any area.
+// Cells are as wide as the longest reach, so a query looks at 3x3 cells. Members are
+// copied out sorted by bucket, the members of a bucket are one run of each array and
+// are tested four at a time.
+class CrowdGrid {
+public:
+	void Build(const CrowdSoA& crowd, float spacing);
+
+	// Sum of pushes away from every member closer than its radius plus radius plus spacing,
+	// falling off linearly to nothing at that distance and scaled by the member's weight.
+	// Members right at position are left out, that is the agent itself.
+	glm::vec3 Separation(const glm::vec3& position, float radius) const;
+
+private:
+	uint32_t Bucket(int x, int z) const;
+
+	float cell_size_ = 1.0f;
+	float spacing_ = 0.0f;
+	uint32_t mask_ = 0;
+	// Members of bucket b are [bucket_start_[b], bucket_start_[b + 1]) of the arrays below.
+	std::vector<uint32_t> bucket_start_;
+	std::vector<float> x_;
+	std::vector<float> z_;
+	std::vector<float> radius_;
+	std::vector<float> weight_;
+};
+
+#endif
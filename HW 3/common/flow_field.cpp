@@ -0,0 +1,153 @@
+#include <vector>
+#include <queue>
+#include <future>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "flow_field.hpp"
+
+// Extra cost of a cell right at an obstacle's edge, falling to none at the margin.
+static const float margin_cost = 4.0f;
+static const float blocked = std::numeric_limits<float>::infinity();
+
+static const int neighbour_x[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int neighbour_z[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+static const float neighbour_length[8] = { 1.0f, 1.0f, 1.0f, 1.0f, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f };
+
+void FlowField::CellOf(const glm::vec3& position, float cell_size, int& x, int& z) {
+	x = int(std::floor(position.x / cell_size));
+	z = int(std::floor(position.z / cell_size));
+}
+
+void FlowField::Build(const glm::vec3& goal, const std::vector<FlowObstacle>& obstacles, int size, float cell_size, float margin) {
+	size_ = size;
+	cell_size_ = cell_size;
+	int goal_x;
+	int goal_z;
+	CellOf(goal, cell_size, goal_x, goal_z);
+	origin_x_ = goal_x - size / 2;
+	origin_z_ = goal_z - size / 2;
+
+	size_t cells = size_t(size) * size_t(size);
+	std::vector<float> cost(cells, 1.0f);
+	for (const FlowObstacle& obstacle : obstacles) {
+		float reach = obstacle.radius + margin + cell_size;
+		int x_from = std::max(0, int(std::floor((obstacle.position.x - reach) / cell_size)) - origin_x_);
+		int x_to = std::min(size - 1, int(std::floor((obstacle.position.x + reach) / cell_size)) - origin_x_);
+		int z_from = std::max(0, int(std::floor((obstacle.position.z - reach) / cell_size)) - origin_z_);
+		int z_to = std::min(size - 1, int(std::floor((obstacle.position.z + reach) / cell_size)) - origin_z_);
+		for (int z = z_from; z <= z_to; ++z) {
+			for (int x = x_from; x <= x_to; ++x) {
+				float dx = (origin_x_ + x + 0.5f) * cell_size - obstacle.position.x;
+				float dz = (origin_z_ + z + 0.5f) * cell_size - obstacle.position.z;
+				// Distance from the obstacle's edge to the cell's, taking the cell as a circle.
+				float gap = std::sqrt(dx * dx + dz * dz) - obstacle.radius - cell_size * 0.5f;
+				float& cell = cost[size_t(z) * size + x];
+				if (gap < 0.0f) {
+					cell = blocked;
+				}
+				else if (gap < margin) {
+					cell = std::max(cell, 1.0f + margin_cost * (1.0f - gap / margin));
+				}
+			}
+		}
+	}
+
+	// The goal is where the player stands, whatever the margins say.
+	uint32_t goal_cell = uint32_t((size / 2) * size + size / 2);
+	cost[goal_cell] = 1.0f;
+
+	// Diagonal steps may not cut the corner of a blocked cell.
+	auto step = [&](int x, int z, int n, uint32_t& next) {
+		int nx = x + neighbour_x[n];
+		int nz = z + neighbour_z[n];
+		if (nx < 0 || nz < 0 || nx >= size || nz >= size) {
+			return false;
+		}
+		next = uint32_t(nz * size + nx);
+		if (cost[next] == blocked) {
+			return false;
+		}
+		return n < 4 || (cost[size_t(z) * size + nx] != blocked && cost[size_t(nz) * size + x] != blocked);
+	};
+
+	std::vector<float> distance(cells, blocked);
+	typedef std::pair<float, uint32_t> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	distance[goal_cell] = 0.0f;
+	open.push(Entry(0.0f, goal_cell));
+	while (!open.empty()) {
+		Entry entry = open.top();
+		open.pop();
+		if (entry.first > distance[entry.second]) {
+			continue;
+		}
+		int x = int(entry.second % size);
+		int z = int(entry.second / size);
+		for (int n = 0; n < 8; ++n) {
+			uint32_t next;
+			if (!step(x, z, n, next)) {
+				continue;
+			}
+			float d = entry.first + neighbour_length[n] * 0.5f * (cost[entry.second] + cost[next]);
+			if (d < distance[next]) {
+				distance[next] = d;
+				open.push(Entry(d, next));
+			}
+		}
+	}
+
+	directions_.assign(cells, uint8_t(no_direction));
+	reachable_ = 0;
+	for (int z = 0; z < size; ++z) {
+		for (int x = 0; x < size; ++x) {
+			uint32_t cell = uint32_t(z * size + x);
+			if (distance[cell] == blocked) {
+				continue;
+			}
+			++reachable_;
+			float best = distance[cell];
+			for (int n = 0; n < 8; ++n) {
+				uint32_t next;
+				if (step(x, z, n, next) && distance[next] < best) {
+					best = distance[next];
+					directions_[cell] = uint8_t(n);
+				}
+			}
+		}
+	}
+}
+
+std::future<FlowField> FlowField::BuildAsync(glm::vec3 goal, std::vector<FlowObstacle> obstacles,
+	int size, float cell_size, float margin) {
+	return std::async(std::launch::async, [=, obstacles = std::move(obstacles)]() {
+		FlowField field;
+		field.Build(goal, obstacles, size, cell_size, margin);
+		return field;
+	});
+}
+
+bool FlowField::Sample(const glm::vec3& position, glm::vec3& direction) const {
+	if (directions_.empty()) {
+		return false;
+	}
+	int x;
+	int z;
+	CellOf(position, cell_size_, x, z);
+	x -= origin_x_;
+	z -= origin_z_;
+	if (x < 0 || z < 0 || x >= size_ || z >= size_) {
+		return false;
+	}
+	uint8_t n = directions_[size_t(z) * size_ + x];
+	if (n == no_direction) {
+		return false;
+	}
+	direction = glm::vec3(float(neighbour_x[n]), 0.0f, float(neighbour_z[n])) / neighbour_length[n];
+	return true;
+}
@@ -0,0 +1,55 @@
+#ifndef FLOW_FIELD_HPP
+#define FLOW_FIELD_HPP
+
+#include <vector>
+#include <future>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Circle in the ground plane that is in the way, from a static collider.
+struct FlowObstacle {
+	glm::vec3 position;
+	float radius;
+};
+
+// Ways to one goal over a square grid in the XZ plane, centered on the goal's cell and
+// aligned to world cells. Built with Dijkstra from the goal over 8 neighbours: cells
+// overlapping an obstacle are blocked, cells within margin of one cost more so paths keep
+// clear of it. Every cell then points at its cheapest neighbour, so any number of agents
+// look their way up with one array access each.
+class FlowField {
+public:
+	FlowField() = default;
+
+	void Build(const glm::vec3& goal, const std::vector<FlowObstacle>& obstacles, int size, float cell_size, float margin);
+
+	// Builds on a worker thread, the obstacles are copied so the caller may change its own.
+	static std::future<FlowField> BuildAsync(glm::vec3 goal, std::vector<FlowObstacle> obstacles,
+		int size, float cell_size, float margin);
+
+	// Unit direction in the XZ plane along the way to the goal. False outside the grid, in the
+	// goal's cell and where the goal can't be reached, callers head straight for it then.
+	bool Sample(const glm::vec3& position, glm::vec3& direction) const;
+
+	// Cell of position on the world aligned grid with this cell size.
+	static void CellOf(const glm::vec3& position, float cell_size, int& x, int& z);
+
+	bool Empty() const { return directions_.empty(); }
+	// Cells the goal can be reached from.
+	size_t Reachable() const { return reachable_; }
+
+private:
+	static const uint8_t no_direction = 8;
+
+	int size_ = 0;
+	float cell_size_ = 1.0f;
+	// World cell of the first grid cell.
+	int origin_x_ = 0;
+	int origin_z_ = 0;
+	size_t reachable_ = 0;
+	// Neighbour each cell leads to, no_direction at the goal and where it can't be reached.
+	std::vector<uint8_t> directions_;
+};
+
+#endif
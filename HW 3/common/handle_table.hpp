@@ -0,0 +1,96 @@
+#ifndef HANDLE_TABLE_HPP
+#define HANDLE_TABLE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+// Reference to an entry of a HandleTable: its slot and the generation the slot had
+// when the entry was made. Slots are reused with the next generation, so a handle to
+// a removed entry never resolves to whatever took its place.
+struct Handle {
+	uint32_t index = 0xffffffffu;
+	uint32_t generation = 0;
+
+	bool operator==(const Handle& handle) const { return index == handle.index && generation == handle.generation; }
+	bool operator!=(const Handle& handle) const { return !(*this == handle); }
+};
+
+// Maps handles to positions in dense storage kept by the owner, which reports every
+// move (swap removal, compaction). A lookup is one array access and one compare.
+class HandleTable {
+public:
+	static const uint32_t null_position = 0xffffffffu;
+
+	Handle Create(uint32_t position) {
+		uint32_t index;
+		if (free_list_ != null_position) {
+			index = free_list_;
+			free_list_ = slots_[index].position;
+		}
+		else {
+			index = uint32_t(slots_.size());
+			slots_.push_back(Slot());
+		}
+		slots_[index].position = position;
+		slots_[index].live = true;
+		++size_;
+		return Handle{ index, slots_[index].generation };
+	}
+
+	void Destroy(Handle handle) {
+		assert(Valid(handle) && "destroying a stale handle");
+		Slot& slot = slots_[handle.index];
+		++slot.generation;
+		slot.live = false;
+		slot.position = free_list_;
+		free_list_ = handle.index;
+		--size_;
+	}
+
+	void Move(Handle handle, uint32_t position) {
+		assert(Valid(handle) && "moving a stale handle");
+		slots_[handle.index].position = position;
+	}
+
+	bool Valid(Handle handle) const {
+		return handle.index < slots_.size() && slots_[handle.index].live &&
+			slots_[handle.index].generation == handle.generation;
+	}
+
+	// Position of a live entry. Debug builds stop at stale handles here.
+	uint32_t Position(Handle handle) const {
+		assert(Valid(handle) && "stale handle");
+		return slots_[handle.index].position;
+	}
+
+	// Position, or null_position if the entry is gone.
+	uint32_t Find(Handle handle) const {
+		return Valid(handle) ? slots_[handle.index].position : null_position;
+	}
+
+	// Destroys every entry, handles made before stay invalid for good.
+	void Clear() {
+		for (uint32_t index = 0; index < slots_.size(); ++index) {
+			if (slots_[index].live) {
+				Destroy(Handle{ index, slots_[index].generation });
+			}
+		}
+	}
+
+	size_t Size() const { return size_; }
+
+private:
+	struct Slot {
+		// Position in the owner's storage, next free slot for free ones.
+		uint32_t position = null_position;
+		uint32_t generation = 0;
+		bool live = false;
+	};
+
+	std::vector<Slot> slots_;
+	uint32_t free_list_ = null_position;
+	size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+#include "save_file.hpp"
+#include "input_log.hpp"
+
+static const char log_magic[4] = { 'H', 'W', '3', 'R' };
+static const uint32_t log_version = 1;
+
+// The checksum covers the frames.
+struct InputLogHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t seed;
+	uint32_t frame_size;
+	uint64_t frame_count;
+	double tick_rate;
+	uint64_t checksum;
+};
+
+static_assert(sizeof(InputLogHeader) == 40, "input log header layout changed");
+
+void InputLog::Start(uint32_t seed, double tick_rate) {
+	seed_ = seed;
+	tick_rate_ = tick_rate;
+	frames_.clear();
+	next_ = 0;
+}
+
+bool InputLog::Next(InputFrame& frame) {
+	if (next_ >= frames_.size()) {
+		return false;
+	}
+	frame = frames_[next_++];
+	return true;
+}
+
+bool InputLog::Save(const std::string& path) const {
+	InputLogHeader header;
+	memcpy(header.magic, log_magic, sizeof(log_magic));
+	header.version = log_version;
+	header.seed = seed_;
+	header.frame_size = uint32_t(sizeof(InputFrame));
+	header.frame_count = frames_.size();
+	header.tick_rate = tick_rate_;
+	header.checksum = SaveChecksum(frames_.data(), frames_.size() * sizeof(InputFrame));
+
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(frames_.data()), std::streamsize(frames_.size() * sizeof(InputFrame)));
+		if (!file) {
+			return false;
+		}
+	}
+	return RenameOver(temporary, path);
+}
+
+bool InputLog::Load(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		return false;
+	}
+	uint64_t size = uint64_t(file.tellg());
+	file.seekg(0);
+	InputLogHeader header;
+	if (size < sizeof(header) || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		memcmp(header.magic, log_magic, sizeof(log_magic)) != 0 ||
+		header.version != log_version || header.frame_size != sizeof(InputFrame)) {
+		return false;
+	}
+	// The count has to match the file before it sizes anything.
+	if (header.frame_count != (size - sizeof(header)) / sizeof(InputFrame) ||
+		(size - sizeof(header)) % sizeof(InputFrame) != 0) {
+		return false;
+	}
+
+	std::vector<InputFrame> frames(size_t(header.frame_count));
+	if (!file.read(reinterpret_cast<char*>(frames.data()), std::streamsize(frames.size() * sizeof(InputFrame))) ||
+		SaveChecksum(frames.data(), frames.size() * sizeof(InputFrame)) != header.checksum) {
+		return false;
+	}
+	seed_ = header.seed;
+	tick_rate_ = header.tick_rate;
+	frames_.swap(frames);
+	next_ = 0;
+	return true;
+}
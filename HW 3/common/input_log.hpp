@@ -0,0 +1,48 @@
+#ifndef INPUT_LOG_HPP
+#define INPUT_LOG_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// What the player did in one tick: buttons held as bits, and how far the cursor moved
+// since the tick before, in pixels.
+struct InputFrame {
+	uint32_t buttons = 0;
+	float look_x = 0.0f;
+	float look_y = 0.0f;
+
+	bool Held(uint32_t button) const { return (buttons & button) != 0; }
+};
+
+static_assert(sizeof(InputFrame) == 12, "input frame layout changed");
+
+// A session as the seed and tick rate it ran with and its input, one frame per tick.
+// Played back with both, the frames give the same game again as long as nothing in it
+// went by wall time.
+class InputLog {
+public:
+	// Forgets the frames, recording starts over.
+	void Start(uint32_t seed, double tick_rate);
+	void Record(const InputFrame& frame) { frames_.push_back(frame); }
+
+	// Frame of the next tick played back, false once all have been.
+	bool Next(InputFrame& frame);
+
+	// False if the file can't be written, or read back as a log of this version.
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	uint32_t Seed() const { return seed_; }
+	double TickRate() const { return tick_rate_; }
+	size_t Size() const { return frames_.size(); }
+
+private:
+	uint32_t seed_ = 0;
+	double tick_rate_ = 0.0;
+	std::vector<InputFrame> frames_;
+	size_t next_ = 0;
+};
+
+#endif
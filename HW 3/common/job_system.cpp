@@ -0,0 +1,148 @@
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#include "job_system.hpp"
+
+static thread_local size_t thread_index = 0;
+
+size_t JobSystem::DefaultWorkers() {
+	size_t cores = std::thread::hardware_concurrency();
+	return cores > 1 ? cores - 1 : 0;
+}
+
+size_t JobSystem::ThreadIndex() {
+	return thread_index;
+}
+
+JobSystem::JobSystem(size_t workers) {
+	for (size_t i = 0; i <= workers; ++i) {
+		queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+	}
+	for (size_t i = 1; i <= workers; ++i) {
+		threads_.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stop_ = true;
+	}
+	sleep_.notify_all();
+	for (std::thread& thread : threads_) {
+		thread.join();
+	}
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter* counter, JobCounter* dependency) {
+	if (counter != nullptr) {
+		counter->pending_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job entry{ std::move(job), counter };
+	if (dependency != nullptr) {
+		// Checked under the lock Execute takes to release the waiting list, so the job cannot be missed.
+		std::lock_guard<std::mutex> lock(dependency->mutex_);
+		if (!dependency->Done()) {
+			dependency->waiting_.push_back(std::move(entry));
+			return;
+		}
+	}
+	Push(std::move(entry));
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+	size_t index = ThreadIndex();
+	while (!counter.Done()) {
+		Job job;
+		if (Pop(index, job)) {
+			Execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	// The last job may still hold the lock while releasing the waiting jobs, the counter
+	// must outlive that once we return.
+	std::lock_guard<std::mutex> lock(counter.mutex_);
+}
+
+void JobSystem::Push(Job job) {
+	Queue& queue = *queues_[ThreadIndex() % queues_.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		++queued_;
+	}
+	sleep_.notify_one();
+}
+
+bool JobSystem::Pop(size_t index, Job& job) {
+	{
+		Queue& own = *queues_[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			--queued_;
+			return true;
+		}
+	}
+	for (size_t offset = 1; offset < queues_.size(); ++offset) {
+		Queue& victim = *queues_[(index + offset) % queues_.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			--queued_;
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::Execute(Job& job) {
+	job.function();
+
+	JobCounter* counter = job.counter;
+	if (counter == nullptr) {
+		return;
+	}
+
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex_);
+		if (counter->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			released.swap(counter->waiting_);
+		}
+	}
+	for (Job& next : released) {
+		Push(std::move(next));
+	}
+}
+
+void JobSystem::WorkerLoop(size_t index) {
+	thread_index = index;
+	while (true) {
+		Job job;
+		if (Pop(index, job)) {
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		sleep_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+		if (stop_) {
+			return;
+		}
+	}
+}
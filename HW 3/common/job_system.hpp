@@ -0,0 +1,105 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+class JobSystem;
+
+// Number of unfinished jobs attached to it. Jobs can be made to depend on a
+// counter, they are queued only once it drops to zero.
+class JobCounter {
+public:
+	bool Done() const { return pending_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct Job {
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	std::atomic<int> pending_{ 0 };
+	std::mutex mutex_;
+	std::vector<Job> waiting_;
+};
+
+// Work stealing scheduler: every thread owns a deque, pushes and pops at its
+// back and steals from the front of the others when it runs dry. The thread
+// that created the system takes part as worker 0 while it waits.
+class JobSystem {
+public:
+	// workers is the number of extra threads, by default one per remaining core.
+	explicit JobSystem(size_t workers = DefaultWorkers());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	static size_t DefaultWorkers();
+
+	// Threads running jobs, the calling one included.
+	size_t ThreadCount() const { return queues_.size(); }
+
+	// Index of the calling thread in [0, ThreadCount()), 0 for the owner thread.
+	static size_t ThreadIndex();
+
+	// Queues the job, counter (if any) is done once it has run.
+	// With a dependency the job is queued only after the dependency is done.
+	void Run(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// Runs jobs until the counter is done.
+	void Wait(JobCounter& counter);
+
+	// Calls f(i) for every i in [begin, end), in chunks of grain indices per job.
+	template <typename F>
+	void ParallelFor(size_t begin, size_t end, size_t grain, F f, JobCounter& counter, JobCounter* dependency = nullptr) {
+		grain = std::max<size_t>(grain, 1);
+		for (size_t first = begin; first < end; first += grain) {
+			size_t last = std::min(end, first + grain);
+			Run([f, first, last]() {
+				for (size_t i = first; i < last; ++i) {
+					f(i);
+				}
+			}, &counter, dependency);
+		}
+	}
+
+	template <typename F>
+	void ParallelFor(size_t begin, size_t end, size_t grain, F f) {
+		JobCounter counter;
+		ParallelFor(begin, end, grain, f, counter);
+		Wait(counter);
+	}
+
+private:
+	typedef JobCounter::Job Job;
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void Push(Job job);
+	bool Pop(size_t index, Job& job);
+	void Execute(Job& job);
+	void WorkerLoop(size_t index);
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+	std::vector<std::thread> threads_;
+
+	std::atomic<int> queued_{ 0 };
+	std::atomic<bool> stop_{ false };
+	std::mutex sleep_mutex_;
+	std::condition_variable sleep_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "narrowphase.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NARROWPHASE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(NARROWPHASE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+static inline bool OverlapPair(const SphereSoA& s, uint32_t a, uint32_t b) {
+	float dx = s.x[a] - s.x[b];
+	float dy = s.y[a] - s.y[b];
+	float dz = s.z[a] - s.z[b];
+	float r = s.radius[a] + s.radius[b];
+	return dx * dx + dy * dy + dz * dz < r * r;
+}
+
+static void OverlapScalar(const SphereSoA& s, const uint32_t* a, const uint32_t* b, size_t first, size_t count, uint64_t* hits) {
+	for (size_t i = first; i < count; ++i) {
+		if (OverlapPair(s, a[i], b[i])) {
+			hits[i / 64] |= uint64_t(1) << (i % 64);
+		}
+	}
+}
+
+#ifdef NARROWPHASE_X86
+
+static void OverlapSSE2(const SphereSoA& s, const uint32_t* a, const uint32_t* b, size_t count, uint64_t* hits) {
+	const float* x = s.x.data();
+	const float* y = s.y.data();
+	const float* z = s.z.data();
+	const float* r = s.radius.data();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		// SSE2 has no gather, the loads are scalar and the math is packed.
+		__m128 dx = _mm_sub_ps(_mm_setr_ps(x[a[i]], x[a[i + 1]], x[a[i + 2]], x[a[i + 3]]),
+			_mm_setr_ps(x[b[i]], x[b[i + 1]], x[b[i + 2]], x[b[i + 3]]));
+		__m128 dy = _mm_sub_ps(_mm_setr_ps(y[a[i]], y[a[i + 1]], y[a[i + 2]], y[a[i + 3]]),
+			_mm_setr_ps(y[b[i]], y[b[i + 1]], y[b[i + 2]], y[b[i + 3]]));
+		__m128 dz = _mm_sub_ps(_mm_setr_ps(z[a[i]], z[a[i + 1]], z[a[i + 2]], z[a[i + 3]]),
+			_mm_setr_ps(z[b[i]], z[b[i + 1]], z[b[i + 2]], z[b[i + 3]]));
+		__m128 rr = _mm_add_ps(_mm_setr_ps(r[a[i]], r[a[i + 1]], r[a[i + 2]], r[a[i + 3]]),
+			_mm_setr_ps(r[b[i]], r[b[i + 1]], r[b[i + 2]], r[b[i + 3]]));
+
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		int mask = _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_mul_ps(rr, rr)));
+		// i is a multiple of 4, so the 4 bits never straddle two words.
+		hits[i / 64] |= uint64_t(mask) << (i % 64);
+	}
+	OverlapScalar(s, a, b, i, count, hits);
+}
+
+TARGET_AVX2
+static void OverlapAVX2(const SphereSoA& s, const uint32_t* a, const uint32_t* b, size_t count, uint64_t* hits) {
+	const float* x = s.x.data();
+	const float* y = s.y.data();
+	const float* z = s.z.data();
+	const float* r = s.radius.data();
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i ia = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		__m256i ib = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+
+		__m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(x, ia, 4), _mm256_i32gather_ps(x, ib, 4));
+		__m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(y, ia, 4), _mm256_i32gather_ps(y, ib, 4));
+		__m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(z, ia, 4), _mm256_i32gather_ps(z, ib, 4));
+		__m256 rr = _mm256_add_ps(_mm256_i32gather_ps(r, ia, 4), _mm256_i32gather_ps(r, ib, 4));
+
+		__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_mul_ps(rr, rr), _CMP_LT_OQ));
+		hits[i / 64] |= uint64_t(mask) << (i % 64);
+	}
+	OverlapScalar(s, a, b, i, count, hits);
+}
+
+static bool HasAVX2() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+typedef void (*OverlapKernel)(const SphereSoA&, const uint32_t*, const uint32_t*, size_t, uint64_t*);
+
+struct KernelChoice {
+	OverlapKernel kernel;
+	const char* name;
+};
+
+static KernelChoice ChooseKernel() {
+#ifdef NARROWPHASE_X86
+	if (HasAVX2()) {
+		return KernelChoice{ &OverlapAVX2, "avx2" };
+	}
+	return KernelChoice{ &OverlapSSE2, "sse2" };
+#else
+	return KernelChoice{ [](const SphereSoA& s, const uint32_t* a, const uint32_t* b, size_t count, uint64_t* hits) {
+		OverlapScalar(s, a, b, 0, count, hits);
+	}, "scalar" };
+#endif
+}
+
+static const KernelChoice& Kernel() {
+	static const KernelChoice choice = ChooseKernel();
+	return choice;
+}
+
+void OverlapSpherePairs(const SphereSoA& spheres, const uint32_t* a, const uint32_t* b, size_t count, uint64_t* hits) {
+	memset(hits, 0, ((count + 63) / 64) * sizeof(uint64_t));
+	Kernel().kernel(spheres, a, b, count, hits);
+}
+
+const char* NarrowphaseKernel() {
+	return Kernel().name;
+}
@@ -0,0 +1,43 @@
+#ifndef NARROWPHASE_HPP
+#define NARROWPHASE_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Sphere centers and radii, one array per component so pairs can be tested in SIMD lanes.
+struct SphereSoA {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	void Clear() {
+		x.clear();
+		y.clear();
+		z.clear();
+		radius.clear();
+	}
+
+	void Push(const glm::vec3& center, float r) {
+		x.push_back(center.x);
+		y.push_back(center.y);
+		z.push_back(center.z);
+		radius.push_back(r);
+	}
+
+	size_t Size() const {
+		return x.size();
+	}
+};
+
+// Sets bit i of hits when spheres a[i] and b[i] overlap, that is when their squared
+// distance is below their squared radius sum. hits needs (count + 63) / 64 words.
+// Uses AVX2 when the CPU has it, SSE2 otherwise.
+void OverlapSpherePairs(const SphereSoA& spheres, const uint32_t* a, const uint32_t* b, size_t count, uint64_t* hits);
+
+// Name of the kernel OverlapSpherePairs picked on this CPU.
+const char* NarrowphaseKernel();
+
+#endif
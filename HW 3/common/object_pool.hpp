@@ -0,0 +1,148 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <cstddef>
+
+// Blocks of one size carved from big chunks, freed blocks are handed out again first.
+// Chunks are only released with the pool. Locked, since objects are created from jobs.
+class BlockPool {
+public:
+	explicit BlockPool(size_t block_size, size_t blocks_per_chunk = 256)
+		: block_size_(RoundUp(block_size)), blocks_per_chunk_(blocks_per_chunk) {}
+
+	~BlockPool() {
+		for (void* chunk : chunks_) {
+			::operator delete(chunk);
+		}
+	}
+
+	BlockPool(const BlockPool&) = delete;
+	BlockPool& operator=(const BlockPool&) = delete;
+
+	void* Allocate() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (free_ == nullptr) {
+			Grow();
+		}
+		FreeBlock* block = free_;
+		free_ = block->next;
+		++live_;
+		return block;
+	}
+
+	void Free(void* block) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		FreeBlock* freed = static_cast<FreeBlock*>(block);
+		freed->next = free_;
+		free_ = freed;
+		--live_;
+	}
+
+	size_t Live() const { return live_; }
+	size_t Capacity() const { return chunks_.size() * blocks_per_chunk_; }
+
+private:
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	static size_t RoundUp(size_t size) {
+		const size_t align = alignof(std::max_align_t);
+		size = size < sizeof(FreeBlock) ? sizeof(FreeBlock) : size;
+		return (size + align - 1) / align * align;
+	}
+
+	void Grow() {
+		char* chunk = static_cast<char*>(::operator new(block_size_ * blocks_per_chunk_));
+		chunks_.push_back(chunk);
+		for (size_t i = blocks_per_chunk_; i-- > 0;) {
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * block_size_);
+			block->next = free_;
+			free_ = block;
+		}
+	}
+
+	size_t block_size_;
+	size_t blocks_per_chunk_;
+	std::vector<void*> chunks_;
+	FreeBlock* free_ = nullptr;
+	size_t live_ = 0;
+	std::mutex mutex_;
+};
+
+// Blocks for sizes only known at run time, such as coroutine frames: one BlockPool per
+// power of two from min_block to max_block, bigger requests go to the global heap.
+// Freeing needs the size the block was allocated with.
+class SizeClassPool {
+public:
+	static const size_t min_block = 64;
+	static const size_t max_block = 2048;
+
+	SizeClassPool() {
+		for (size_t size = min_block; size <= max_block; size *= 2) {
+			pools_.emplace_back(new BlockPool(size, 64));
+		}
+	}
+
+	void* Allocate(size_t size) {
+		return size <= max_block ? pools_[Class(size)]->Allocate() : ::operator new(size);
+	}
+
+	void Free(void* block, size_t size) {
+		if (size <= max_block) {
+			pools_[Class(size)]->Free(block);
+		}
+		else {
+			::operator delete(block);
+		}
+	}
+
+	size_t Live() const {
+		size_t live = 0;
+		for (const std::unique_ptr<BlockPool>& pool : pools_) {
+			live += pool->Live();
+		}
+		return live;
+	}
+
+private:
+	static size_t Class(size_t size) {
+		size_t index = 0;
+		for (size_t block = min_block; block < size; block *= 2) {
+			++index;
+		}
+		return index;
+	}
+
+	std::vector<std::unique_ptr<BlockPool>> pools_;
+};
+
+// Class level new and delete for T from one pool per type. Classes derived from T
+// are bigger than the blocks and fall back to the global heap.
+template <typename T>
+class Pooled {
+public:
+	static void* operator new(size_t size) {
+		return size == sizeof(T) ? Pool().Allocate() : ::operator new(size);
+	}
+
+	static void operator delete(void* block, size_t size) {
+		if (size == sizeof(T)) {
+			Pool().Free(block);
+		}
+		else {
+			::operator delete(block);
+		}
+	}
+
+	static BlockPool& Pool() {
+		static BlockPool pool(sizeof(T));
+		return pool;
+	}
+};
+
+#endif
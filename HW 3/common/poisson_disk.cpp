@@ -0,0 +1,80 @@
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "poisson_disk.hpp"
+
+static const float two_pi = 6.28318531f;
+
+std::vector<glm::vec3> PoissonDiskRing(float r_from, float r_to, float spacing, std::mt19937& rng, int attempts) {
+	std::vector<glm::vec3> points;
+	if (r_to <= r_from || spacing <= 0.0f) {
+		return points;
+	}
+
+	// A cell this small holds one point at most, so a candidate only looks at 5x5 cells.
+	float cell = spacing / std::sqrt(2.0f);
+	int cells = int(std::ceil(2.0f * r_to / cell));
+	std::vector<int> grid(size_t(cells) * size_t(cells), -1);
+	auto cell_of = [&](float v) {
+		return std::min(cells - 1, std::max(0, int((v + r_to) / cell)));
+	};
+
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto fits = [&](const glm::vec3& p) {
+		float r2 = p.x * p.x + p.z * p.z;
+		if (r2 < r_from * r_from || r2 > r_to * r_to) {
+			return false;
+		}
+		int cx = cell_of(p.x);
+		int cz = cell_of(p.z);
+		for (int z = std::max(0, cz - 2); z <= std::min(cells - 1, cz + 2); ++z) {
+			for (int x = std::max(0, cx - 2); x <= std::min(cells - 1, cx + 2); ++x) {
+				int other = grid[size_t(z) * cells + x];
+				if (other >= 0) {
+					glm::vec3 d = points[other] - p;
+					if (d.x * d.x + d.z * d.z < spacing * spacing) {
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	};
+	auto add = [&](const glm::vec3& p) {
+		grid[size_t(cell_of(p.z)) * cells + cell_of(p.x)] = int(points.size());
+		points.push_back(p);
+	};
+
+	// Uniform over the ring's area for the first point.
+	float angle = unit(rng) * two_pi;
+	float radius = std::sqrt(r_from * r_from + unit(rng) * (r_to * r_to - r_from * r_from));
+	add(glm::vec3(std::sin(angle) * radius, 0.0f, std::cos(angle) * radius));
+
+	std::vector<int> active(1, 0);
+	while (!active.empty()) {
+		size_t pick = size_t(unit(rng) * active.size()) % active.size();
+		glm::vec3 center = points[active[pick]];
+		bool placed = false;
+		for (int attempt = 0; attempt < attempts && !placed; ++attempt) {
+			float a = unit(rng) * two_pi;
+			float r = spacing * (1.0f + unit(rng));
+			glm::vec3 candidate = center + glm::vec3(std::sin(a) * r, 0.0f, std::cos(a) * r);
+			if (fits(candidate)) {
+				active.push_back(int(points.size()));
+				add(candidate);
+				placed = true;
+			}
+		}
+		if (!placed) {
+			active[pick] = active.back();
+			active.pop_back();
+		}
+	}
+
+	std::shuffle(points.begin(), points.end(), rng);
+	return points;
+}
@@ -0,0 +1,15 @@
+#ifndef POISSON_DISK_HPP
+#define POISSON_DISK_HPP
+
+#include <vector>
+#include <random>
+
+#include <glm/glm.hpp>
+
+// Blue noise points in the XZ plane within the ring from r_from to r_to around the origin,
+// no two closer than spacing. Bridson's sampling: each point tries attempts candidates
+// around itself before it retires. The points come shuffled, so taking them in order
+// doesn't walk across the ring.
+std::vector<glm::vec3> PoissonDiskRing(float r_from, float r_to, float spacing, std::mt19937& rng, int attempts = 30);
+
+#endif
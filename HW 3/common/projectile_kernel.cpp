@@ -0,0 +1,36 @@
+#include <vector>
+#include <cstdint>
+
+#include "projectile_kernel.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROJECTILE_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+void IntegrateProjectiles(ProjectileSoA& p, float dt) {
+	size_t count = p.Size();
+	float* x = p.x.data();
+	float* y = p.y.data();
+	float* z = p.z.data();
+	const float* vx = p.vx.data();
+	const float* vy = p.vy.data();
+	const float* vz = p.vz.data();
+
+	size_t i = 0;
+
+#ifdef PROJECTILE_KERNEL_SSE2
+	__m128 step = _mm_set1_ps(dt);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(x + i, _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_loadu_ps(vx + i), step)));
+		_mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(vy + i), step)));
+		_mm_storeu_ps(z + i, _mm_add_ps(_mm_loadu_ps(z + i), _mm_mul_ps(_mm_loadu_ps(vz + i), step)));
+	}
+#endif
+
+	for (; i < count; ++i) {
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+		z[i] += vz[i] * dt;
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef PROJECTILE_KERNEL_HPP
+#define PROJECTILE_KERNEL_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Flight state of all projectiles, one array per component.
+struct ProjectileSoA {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> vz;
+
+	void Clear() {
+		x.clear();
+		y.clear();
+		z.clear();
+		vx.clear();
+		vy.clear();
+		vz.clear();
+	}
+
+	void Push(const glm::vec3& position, const glm::vec3& velocity) {
+		x.push_back(position.x);
+		y.push_back(position.y);
+		z.push_back(position.z);
+		vx.push_back(velocity.x);
+		vy.push_back(velocity.y);
+		vz.push_back(velocity.z);
+	}
+
+	glm::vec3 Position(size_t i) const {
+		return glm::vec3(x[i], y[i], z[i]);
+	}
+
+	size_t Size() const {
+		return x.size();
+	}
+};
+
+// One pass over all projectiles: position += velocity * dt. Lifetimes are timers,
+// the kernel never looks at them.
+void IntegrateProjectiles(ProjectileSoA& projectiles, float dt);
+
+#endif
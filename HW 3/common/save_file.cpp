@@ -0,0 +1,269 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "save_file.hpp"
+
+static const char save_magic[4] = { 'H', 'W', '3', 'S' };
+static const char packed_magic[4] = { 'H', 'W', '3', 'Z' };
+static const size_t min_run = 3;
+static const size_t max_run = 130;
+static const size_t max_literal = 128;
+
+bool RenameOver(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+uint64_t SaveChecksum(const void* data, size_t size, uint64_t hash) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	for (; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void PackBytes(const void* data, size_t size, std::vector<char>& out) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	size_t i = 0;
+	while (i < size) {
+		size_t run = 1;
+		while (i + run < size && run < max_run && bytes[i + run] == bytes[i]) {
+			++run;
+		}
+		if (run >= min_run) {
+			out.push_back(char(run + 125));
+			out.push_back(char(bytes[i]));
+			i += run;
+			continue;
+		}
+
+		// Bytes as they are up to where a run starts.
+		size_t start = i;
+		while (i < size && i - start < max_literal) {
+			if (i + 2 < size && bytes[i] == bytes[i + 1] && bytes[i] == bytes[i + 2]) {
+				break;
+			}
+			++i;
+		}
+		out.push_back(char(i - start - 1));
+		out.insert(out.end(), bytes + start, bytes + i);
+	}
+}
+
+bool UnpackBytes(const void* data, size_t size, std::vector<char>& out, size_t expected) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	out.resize(expected);
+	size_t written = 0;
+	size_t i = 0;
+	while (i < size) {
+		size_t control = bytes[i++];
+		if (control < 128) {
+			size_t count = control + 1;
+			if (i + count > size || written + count > expected) {
+				return false;
+			}
+			memcpy(out.data() + written, bytes + i, count);
+			i += count;
+			written += count;
+		}
+		else {
+			size_t count = control - 125;
+			if (i >= size || written + count > expected) {
+				return false;
+			}
+			memset(out.data() + written, bytes[i++], count);
+			written += count;
+		}
+	}
+	return written == expected;
+}
+
+bool WriteSaveFile(const std::string& path, uint32_t version, double time, const std::vector<SaveType>& types,
+	const void* records, uint32_t record_size, uint64_t record_count, bool packed) {
+	SaveHeader header;
+	memcpy(header.magic, packed ? packed_magic : save_magic, sizeof(save_magic));
+	header.version = version;
+	header.record_size = record_size;
+	header.type_count = uint32_t(types.size());
+	header.record_count = record_count;
+	header.time = time;
+	header.checksum = SaveChecksum(types.data(), types.size() * sizeof(SaveType));
+	header.checksum = SaveChecksum(records, size_t(record_count) * record_size, header.checksum);
+
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (packed) {
+			std::vector<char> body;
+			PackBytes(types.data(), types.size() * sizeof(SaveType), body);
+			PackBytes(records, size_t(record_count) * record_size, body);
+			file.write(body.data(), std::streamsize(body.size()));
+		}
+		else {
+			file.write(reinterpret_cast<const char*>(types.data()), std::streamsize(types.size() * sizeof(SaveType)));
+			file.write(static_cast<const char*>(records), std::streamsize(record_count * record_size));
+		}
+		if (!file) {
+			return false;
+		}
+	}
+	return RenameOver(temporary, path);
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return false;
+	}
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (view == NULL) {
+		return false;
+	}
+	data_ = static_cast<const char*>(view);
+	size_ = size_t(size.QuadPart);
+	mapping_ = const_cast<void*>(view);
+	return true;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	size_ = size_t(info.st_size);
+	void* view = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view != MAP_FAILED) {
+		data_ = static_cast<const char*>(view);
+		mapping_ = view;
+		return true;
+	}
+
+	// Some file systems can't map, the file is read in then.
+	std::ifstream file(path, std::ios::binary);
+	copy_.resize(size_);
+	if (!file.read(copy_.data(), std::streamsize(size_))) {
+		copy_.clear();
+		size_ = 0;
+		return false;
+	}
+	data_ = copy_.data();
+	return true;
+#endif
+}
+
+void MappedFile::Close() {
+	if (mapping_ != nullptr) {
+#ifdef _WIN32
+		UnmapViewOfFile(mapping_);
+#else
+		munmap(mapping_, size_);
+#endif
+	}
+	mapping_ = nullptr;
+	copy_.clear();
+	data_ = nullptr;
+	size_ = 0;
+}
+
+bool SaveReader::Open(const std::string& path, uint32_t version, uint32_t record_size) {
+	header_ = nullptr;
+	if (!file_.Open(path)) {
+		error_ = "can't open the file";
+		return false;
+	}
+	bool packed = file_.Size() >= sizeof(SaveHeader) && memcmp(file_.Data(), packed_magic, sizeof(packed_magic)) == 0;
+	if (file_.Size() < sizeof(SaveHeader) || (!packed && memcmp(file_.Data(), save_magic, sizeof(save_magic)) != 0)) {
+		error_ = "not a save";
+		return false;
+	}
+	const SaveHeader* header = reinterpret_cast<const SaveHeader*>(file_.Data());
+	if (header->version != version) {
+		error_ = "saved by another version";
+		return false;
+	}
+	if (header->record_size != record_size) {
+		error_ = "records of another size";
+		return false;
+	}
+	// The counts are checked against what the file could hold before they size anything,
+	// a packed run of two bytes unpacks to at most max_run.
+	uint64_t stored = file_.Size() - sizeof(SaveHeader);
+	uint64_t limit = packed ? stored * max_run : stored;
+	uint64_t types_size = uint64_t(header->type_count) * sizeof(SaveType);
+	if (types_size > limit || header->record_count > (limit - types_size) / record_size) {
+		error_ = "counts past the end of the file";
+		return false;
+	}
+	uint64_t body = types_size + header->record_count * record_size;
+	const char* data = file_.Data() + sizeof(SaveHeader);
+	if (packed) {
+		if (!UnpackBytes(data, size_t(stored), unpacked_, size_t(body))) {
+			error_ = "damaged packing";
+			return false;
+		}
+		data = unpacked_.data();
+	}
+	else if (stored != body) {
+		error_ = "cut short";
+		return false;
+	}
+	if (SaveChecksum(data, size_t(body)) != header->checksum) {
+		error_ = "checksum mismatch";
+		return false;
+	}
+	header_ = header;
+	types_ = reinterpret_cast<const SaveType*>(data);
+	records_ = data + header->type_count * sizeof(SaveType);
+	error_ = nullptr;
+	return true;
+}
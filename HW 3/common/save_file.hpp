@@ -0,0 +1,92 @@
+#ifndef SAVE_FILE_HPP
+#define SAVE_FILE_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Binary save: a header, a table naming the type ids the records use, then the records,
+// all of one fixed size. The checksum covers everything after the header, before packing
+// if the file is packed. Integers and floats are stored as the machine has them, little
+// endian on everything we build for.
+struct SaveHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t record_size;
+	uint32_t type_count;
+	uint64_t record_count;
+	double time;
+	uint64_t checksum;
+};
+
+struct SaveType {
+	uint32_t id;
+	char name[28];
+};
+
+static_assert(sizeof(SaveHeader) == 40, "save header layout changed");
+static_assert(sizeof(SaveType) == 32, "save type layout changed");
+
+// FNV-1a over 8 byte words, then the bytes left over.
+uint64_t SaveChecksum(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// PackBits: a control byte n below 128 is followed by n + 1 bytes as they are, n from 128
+// repeats the next byte n - 125 times. Records are mostly zeros, which this packs well.
+void PackBytes(const void* data, size_t size, std::vector<char>& out);
+// False if the data is damaged or doesn't unpack to exactly size bytes.
+bool UnpackBytes(const void* data, size_t size, std::vector<char>& out, size_t expected);
+
+// Renames from over to even if to exists, which std::rename doesn't promise.
+bool RenameOver(const std::string& from, const std::string& to);
+
+// Writes the whole file next to path and renames it over path, so a crash while writing
+// leaves the old save. False if it can't be written.
+bool WriteSaveFile(const std::string& path, uint32_t version, double time, const std::vector<SaveType>& types,
+	const void* records, uint32_t record_size, uint64_t record_count, bool packed = false);
+
+// Whole file mapped read only where the platform can, read in otherwise.
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	void* mapping_ = nullptr;
+	std::vector<char> copy_;
+};
+
+// Checks a save and gives its tables and records in place. Only packed saves are copied, unpacked.
+class SaveReader {
+public:
+	// False and an Error() if the file is missing, of another version or record size, cut short or damaged.
+	bool Open(const std::string& path, uint32_t version, uint32_t record_size);
+
+	const char* Error() const { return error_; }
+	double Time() const { return header_->time; }
+	const SaveType* Types() const { return types_; }
+	uint32_t TypeCount() const { return header_->type_count; }
+	const void* Records() const { return records_; }
+	uint64_t RecordCount() const { return header_->record_count; }
+
+private:
+	MappedFile file_;
+	std::vector<char> unpacked_;
+	const SaveHeader* header_ = nullptr;
+	const SaveType* types_ = nullptr;
+	const void* records_ = nullptr;
+	const char* error_ = "not opened";
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include <vector>
+#include <string>
+#include <memory>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+
+#include "save_writer.hpp"
+
+SaveWriter::SaveWriter() : thread_(&SaveWriter::Run, this) {}
+
+SaveWriter::~SaveWriter() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_one();
+	thread_.join();
+}
+
+void SaveWriter::Queue(Job job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto same = std::find_if(waiting_.begin(), waiting_.end(), [&](const Job& waiting) { return waiting.path == job.path; });
+		if (same != waiting_.end()) {
+			++stats_.superseded;
+			*same = std::move(job);
+		}
+		else {
+			waiting_.push_back(std::move(job));
+		}
+	}
+	wake_.notify_one();
+}
+
+bool SaveWriter::Busy() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return writing_ || !waiting_.empty();
+}
+
+void SaveWriter::Wait() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this]() { return !writing_ && waiting_.empty(); });
+}
+
+SaveWriterStats SaveWriter::Stats() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stats_;
+}
+
+void SaveWriter::Run() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		wake_.wait(lock, [this]() { return stop_ || !waiting_.empty(); });
+		if (waiting_.empty()) {
+			return;
+		}
+		std::unique_ptr<Job> job(new Job(std::move(waiting_.front())));
+		waiting_.pop_front();
+		writing_ = true;
+		lock.unlock();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		bool ok = WriteSaveFile(job->path, job->version, job->time, job->types,
+			job->records, job->record_size, job->record_count, true);
+		std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+		uint64_t bytes = 0;
+		if (ok) {
+			std::ifstream file(job->path, std::ios::binary | std::ios::ate);
+			bytes = uint64_t(file.tellg());
+		}
+		job.reset();
+
+		lock.lock();
+		writing_ = false;
+		if (ok) {
+			++stats_.written;
+			stats_.last_seconds = took.count();
+			stats_.last_bytes = bytes;
+		}
+		else {
+			++stats_.failed;
+		}
+		if (waiting_.empty()) {
+			idle_.notify_all();
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef SAVE_WRITER_HPP
+#define SAVE_WRITER_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+#include "save_file.hpp"
+
+struct SaveWriterStats {
+	uint64_t written = 0;
+	uint64_t failed = 0;
+	// Snapshots dropped since a newer one for the same file came before they were written.
+	uint64_t superseded = 0;
+	// Last save, from taking it on to the rename.
+	double last_seconds = 0.0;
+	uint64_t last_bytes = 0;
+};
+
+// Writes saves on a thread of its own, packed. Save takes the snapshot over and returns at
+// once, the game never waits on the disk. One save is written at a time, in the order they
+// came, a snapshot still waiting when the next for the same file comes is dropped for it.
+class SaveWriter {
+public:
+	SaveWriter();
+	// Writes what is still waiting before it returns.
+	~SaveWriter();
+
+	SaveWriter(const SaveWriter&) = delete;
+	SaveWriter& operator=(const SaveWriter&) = delete;
+
+	template <typename Record>
+	void Save(const std::string& path, uint32_t version, double time, std::vector<SaveType> types, std::vector<Record> records) {
+		auto owner = std::make_shared<std::vector<Record>>(std::move(records));
+		Job job{ path, version, time, std::move(types), owner, owner->data(), uint32_t(sizeof(Record)), owner->size() };
+		Queue(std::move(job));
+	}
+
+	// True while a save is waiting or being written.
+	bool Busy();
+	// Blocks until the saves handed over are written.
+	void Wait();
+	SaveWriterStats Stats();
+
+private:
+	struct Job {
+		std::string path;
+		uint32_t version;
+		double time;
+		std::vector<SaveType> types;
+		std::shared_ptr<const void> owner;
+		const void* records;
+		uint32_t record_size;
+		uint64_t record_count;
+	};
+
+	void Queue(Job job);
+	void Run();
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable idle_;
+	// At most one job per path.
+	std::deque<Job> waiting_;
+	bool writing_ = false;
+	bool stop_ = false;
+	SaveWriterStats stats_;
+	std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstring>
+
+#include "save_file.hpp"
+#include "snapshot_ring.hpp"
+
+// Bytes in the same place of both, XORed into out. Bytes past the end of the keyframe
+// are taken as they are.
+static void XorAgainst(const std::vector<char>& keyframe, const char* data, size_t size, std::vector<char>& out) {
+	out.resize(size);
+	size_t common = std::min(size, keyframe.size());
+	for (size_t i = 0; i < common; ++i) {
+		out[i] = char(data[i] ^ keyframe[i]);
+	}
+	if (size > common) {
+		memcpy(out.data() + common, data + common, size - common);
+	}
+}
+
+SnapshotRing::SnapshotRing(size_t memory_cap, size_t keyframe_every)
+	: memory_cap_(memory_cap), keyframe_every_(std::max<size_t>(keyframe_every, 1)) {}
+
+size_t SnapshotRing::Footprint(const Keyframe& keyframe) {
+	size_t bytes = keyframe.data.capacity();
+	for (const Delta& delta : keyframe.deltas) {
+		bytes += delta.packed.capacity();
+	}
+	return bytes;
+}
+
+void SnapshotRing::Push(double time, const void* data, size_t size) {
+	const char* bytes = static_cast<const char*>(data);
+	++stats_.pushed;
+	if (keyframes_.empty() || keyframes_.back().deltas.size() + 1 >= keyframe_every_) {
+		Keyframe keyframe;
+		keyframe.time = time;
+		keyframe.data.assign(bytes, bytes + size);
+		bytes_ += keyframe.data.capacity();
+		keyframes_.push_back(std::move(keyframe));
+		++stats_.keyframes;
+	}
+	else {
+		Keyframe& keyframe = keyframes_.back();
+		XorAgainst(keyframe.data, bytes, size, scratch_);
+		Delta delta;
+		delta.time = time;
+		delta.size = size;
+		PackBytes(scratch_.data(), size, delta.packed);
+		delta.packed.shrink_to_fit();
+		bytes_ += delta.packed.capacity();
+		keyframe.deltas.push_back(std::move(delta));
+	}
+
+	while (bytes_ > memory_cap_ && keyframes_.size() > 1) {
+		bytes_ -= Footprint(keyframes_.front());
+		keyframes_.pop_front();
+		++stats_.evicted;
+	}
+}
+
+bool SnapshotRing::Rewind(double time, std::vector<char>& out, double& at) {
+	if (keyframes_.empty() || keyframes_.front().time > time) {
+		return false;
+	}
+	// The snapshot is read out first, so one that fails to unpack leaves the ring as it was.
+	size_t kept = keyframes_.size();
+	while (keyframes_[kept - 1].time > time) {
+		--kept;
+	}
+	Keyframe& keyframe = keyframes_[kept - 1];
+	size_t kept_deltas = keyframe.deltas.size();
+	while (kept_deltas > 0 && keyframe.deltas[kept_deltas - 1].time > time) {
+		--kept_deltas;
+	}
+
+	if (kept_deltas == 0) {
+		out = keyframe.data;
+		at = keyframe.time;
+	}
+	else {
+		const Delta& delta = keyframe.deltas[kept_deltas - 1];
+		if (!UnpackBytes(delta.packed.data(), delta.packed.size(), scratch_, delta.size)) {
+			return false;
+		}
+		XorAgainst(keyframe.data, scratch_.data(), delta.size, out);
+		at = delta.time;
+	}
+
+	while (keyframe.deltas.size() > kept_deltas) {
+		bytes_ -= keyframe.deltas.back().packed.capacity();
+		keyframe.deltas.pop_back();
+	}
+	while (keyframes_.size() > kept) {
+		bytes_ -= Footprint(keyframes_.back());
+		keyframes_.pop_back();
+	}
+	++stats_.rewinds;
+	return true;
+}
+
+void SnapshotRing::Clear() {
+	keyframes_.clear();
+	bytes_ = 0;
+}
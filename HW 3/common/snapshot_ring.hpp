@@ -0,0 +1,61 @@
+#ifndef SNAPSHOT_RING_HPP
+#define SNAPSHOT_RING_HPP
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+struct SnapshotRingStats {
+	uint64_t pushed = 0;
+	uint64_t keyframes = 0;
+	// Keyframes dropped with their deltas to stay under the memory cap.
+	uint64_t evicted = 0;
+	uint64_t rewinds = 0;
+};
+
+// Snapshots of a byte array at increasing game times, to rewind to. Every keyframe_every-th
+// one is kept whole, the ones between as their XOR against it, packed: bytes that didn't
+// change XOR to runs of zeros. The oldest keyframe goes with its deltas once the ring
+// holds more than memory_cap bytes, the newest is always kept.
+class SnapshotRing {
+public:
+	SnapshotRing(size_t memory_cap, size_t keyframe_every);
+
+	void Push(double time, const void* data, size_t size);
+
+	// The newest snapshot at or before time into out, false and nothing dropped if there is
+	// none that old. Snapshots after it are dropped, pushes go on from there.
+	bool Rewind(double time, std::vector<char>& out, double& at);
+
+	void Clear();
+	bool Empty() const { return keyframes_.empty(); }
+	// Time of the oldest snapshot held, valid if not empty.
+	double Oldest() const { return keyframes_.front().time; }
+	size_t Bytes() const { return bytes_; }
+	const SnapshotRingStats& Stats() const { return stats_; }
+
+private:
+	struct Delta {
+		double time;
+		size_t size;
+		std::vector<char> packed;
+	};
+
+	struct Keyframe {
+		double time;
+		std::vector<char> data;
+		std::vector<Delta> deltas;
+	};
+
+	static size_t Footprint(const Keyframe& keyframe);
+
+	size_t memory_cap_;
+	size_t keyframe_every_;
+	std::deque<Keyframe> keyframes_;
+	std::vector<char> scratch_;
+	size_t bytes_ = 0;
+	SnapshotRingStats stats_;
+};
+
+#endif
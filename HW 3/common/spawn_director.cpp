@@ -0,0 +1,80 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "spawn_director.hpp"
+
+// The rate shrinks by e every second over budget and grows by e every four seconds below
+// half of it, so overload is shed fast and load is only added back slowly.
+static const double throttle_speed = 1.0;
+static const double boost_speed = 0.25;
+static const double boost_below = 0.5;
+// Weight of the newest cost in the running averages.
+static const double smoothing = 0.1;
+
+SpawnDirector::SpawnDirector(double sim_budget, double render_budget, size_t max_objects)
+	: sim_budget_(sim_budget), render_budget_(render_budget), max_objects_(max_objects) {}
+
+void SpawnDirector::Measure(double sim_seconds, double render_seconds, size_t objects, double dt) {
+	objects_ = objects;
+	sim_cost_ = sim_cost_ == 0.0 ? sim_seconds : sim_cost_ + (sim_seconds - sim_cost_) * smoothing;
+	render_cost_ = render_cost_ == 0.0 ? render_seconds : render_cost_ + (render_seconds - render_cost_) * smoothing;
+	if (std::isinf(sim_budget_) && std::isinf(render_budget_)) {
+		return;
+	}
+
+	double load = std::max(sim_cost_ / sim_budget_, render_cost_ / render_budget_);
+	++stats_.measures;
+	if (load > 1.0) {
+		rate_ *= std::exp(-throttle_speed * dt);
+		++stats_.throttled;
+	}
+	else if (load < boost_below) {
+		rate_ *= std::exp(boost_speed * dt);
+		++stats_.boosted;
+	}
+	rate_ = std::min(max_rate, std::max(min_rate, rate_));
+	stats_.rate_min = std::min(stats_.rate_min, rate_);
+	stats_.rate_max = std::max(stats_.rate_max, rate_);
+}
+
+bool SpawnDirector::AllowSpawn() {
+	if (objects_ >= max_objects_) {
+		++stats_.capped;
+		return false;
+	}
+	return true;
+}
+
+bool SpawnDirector::LoadScript(const std::string& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+	waves_.clear();
+	SpawnWave wave;
+	while (file >> wave.time >> wave.count >> wave.enemy_share) {
+		waves_.push_back(wave);
+	}
+	std::stable_sort(waves_.begin(), waves_.end(), [](const SpawnWave& a, const SpawnWave& b) {
+		return a.time < b.time;
+	});
+	next_wave_ = 0;
+	scripted_ = true;
+	return true;
+}
+
+double SpawnDirector::NextWave() const {
+	return next_wave_ < waves_.size() ? waves_[next_wave_].time : double(FLT_MAX);
+}
+
+bool SpawnDirector::TakeWave(double now, SpawnWave& wave) {
+	if (next_wave_ >= waves_.size() || waves_[next_wave_].time > now) {
+		return false;
+	}
+	wave = waves_[next_wave_++];
+	return true;
+}
@@ -0,0 +1,74 @@
+#ifndef SPAWN_DIRECTOR_HPP
+#define SPAWN_DIRECTOR_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Spawns a script asks for at a game time, and the share of them that are enemies.
+struct SpawnWave {
+	double time;
+	int count;
+	float enemy_share;
+};
+
+struct DirectorStats {
+	uint64_t measures = 0;
+	// Measures over budget, and well enough under it to spawn more.
+	uint64_t throttled = 0;
+	uint64_t boosted = 0;
+	// Spawns left out since the object cap was reached.
+	uint64_t capped = 0;
+	double rate_min = 1.0;
+	double rate_max = 1.0;
+};
+
+// Paces spawning by what frames cost. The rate falls while the simulation or drawing
+// takes more than its budget and rises while both stay well under, between min_rate and
+// max_rate times the spawner's own pace, and nothing spawns past max_objects. Costs are
+// wall time, so the pace differs between runs. A wave script replaces it for benchmark
+// scenes, which must spawn the same in every run. With both budgets infinite the pace is
+// off, the rate stays at 1 and only the object cap applies.
+class SpawnDirector {
+public:
+	static constexpr double min_rate = 0.25;
+	static constexpr double max_rate = 4.0;
+
+	// Budgets are seconds per tick for the simulation and per frame for drawing.
+	SpawnDirector(double sim_budget, double render_budget, size_t max_objects);
+
+	// Costs of the last tick and frame, the objects alive and the tick length.
+	void Measure(double sim_seconds, double render_seconds, size_t objects, double dt);
+
+	double Rate() const { return rate_; }
+
+	// False once the world holds max_objects, the spawn is then counted as capped.
+	bool AllowSpawn();
+
+	// Lines of "time count enemy_share", sorted by time on load. False if the file can't be read.
+	bool LoadScript(const std::string& path);
+	bool Scripted() const { return scripted_; }
+	// Game time of the next scripted wave, FLT_MAX once all have come.
+	double NextWave() const;
+	// Takes the next wave due by now, false if there is none.
+	bool TakeWave(double now, SpawnWave& wave);
+
+	const DirectorStats& Stats() const { return stats_; }
+
+private:
+	double sim_budget_;
+	double render_budget_;
+	size_t max_objects_;
+	size_t objects_ = 0;
+	// Smoothed costs, zero until measured.
+	double sim_cost_ = 0.0;
+	double render_cost_ = 0.0;
+	double rate_ = 1.0;
+	bool scripted_ = false;
+	std::vector<SpawnWave> waves_;
+	size_t next_wave_ = 0;
+	DirectorStats stats_;
+};
+
+#endif
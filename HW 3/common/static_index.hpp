@@ -0,0 +1,234 @@
+#ifndef STATIC_INDEX_HPP
+#define STATIC_INDEX_HPP
+
+#include <vector>
+#include <queue>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "aabb.hpp"
+
+// Bounding volume hierarchy over boxes that never move. Built once in one go,
+// rebuilding is the only way to change it, so nodes are a flat array and leaves
+// are ranges of the item array. Ids handed to callbacks are item indices.
+template <typename T>
+class StaticIndex {
+public:
+	void Build(const std::vector<AABB>& boxes, const std::vector<T>& data) {
+		items_.clear();
+		nodes_.clear();
+		for (size_t i = 0; i < boxes.size(); ++i) {
+			items_.push_back(Item{ boxes[i], data[i] });
+		}
+		if (items_.empty()) {
+			return;
+		}
+		nodes_.reserve(2 * items_.size());
+		nodes_.push_back(Node{ AABB(), 0, uint32_t(items_.size()) });
+		Subdivide(0);
+	}
+
+	size_t Size() const { return items_.size(); }
+	const T& Data(int id) const { return items_[id].data; }
+	const AABB& Box(int id) const { return items_[id].box; }
+
+	// Calls callback(id) for every item whose box overlaps box.
+	template <typename F>
+	void Query(const AABB& box, F&& callback) const {
+		if (nodes_.empty()) {
+			return;
+		}
+		uint32_t stack[max_stack];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes_[stack[--top]];
+			if (!node.box.Overlaps(box)) {
+				continue;
+			}
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					if (items_[i].box.Overlaps(box)) {
+						callback(int(i));
+					}
+				}
+			}
+			else {
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+		}
+	}
+
+	void QueryRadius(const glm::vec3& center, float radius, std::vector<int>& out) const {
+		if (nodes_.empty()) {
+			return;
+		}
+		uint32_t stack[max_stack];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes_[stack[--top]];
+			if (!node.box.OverlapsSphere(center, radius)) {
+				continue;
+			}
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					if (items_[i].box.OverlapsSphere(center, radius)) {
+						out.push_back(int(i));
+					}
+				}
+			}
+			else {
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+		}
+	}
+
+	// Up to k items accepted by filter(data) as (squared box distance, id), nearest first.
+	template <typename F>
+	void QueryKNearest(const glm::vec3& center, size_t k, std::vector<std::pair<float, int> >& out, F&& filter) const {
+		if (nodes_.empty() || k == 0) {
+			return;
+		}
+
+		typedef std::pair<float, int> Entry;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+		std::priority_queue<Entry> best;
+
+		open.push(Entry(nodes_[0].box.DistanceSquared(center), 0));
+		while (!open.empty()) {
+			Entry entry = open.top();
+			open.pop();
+			if (best.size() == k && entry.first > best.top().first) {
+				break;
+			}
+
+			const Node& node = nodes_[entry.second];
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					if (!filter(items_[i].data)) {
+						continue;
+					}
+					best.push(Entry(items_[i].box.DistanceSquared(center), int(i)));
+					if (best.size() > k) {
+						best.pop();
+					}
+				}
+			}
+			else {
+				open.push(Entry(nodes_[node.first].box.DistanceSquared(center), int(node.first)));
+				open.push(Entry(nodes_[node.first + 1].box.DistanceSquared(center), int(node.first + 1)));
+			}
+		}
+
+		size_t first = out.size();
+		while (!best.empty()) {
+			out.push_back(best.top());
+			best.pop();
+		}
+		std::reverse(out.begin() + first, out.end());
+	}
+
+	// Same contract as DynamicAABBTree::Raycast.
+	template <typename F>
+	int Raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, F&& callback) const {
+		if (nodes_.empty()) {
+			return -1;
+		}
+
+		glm::vec3 inv_direction(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		int closest = -1;
+
+		uint32_t stack[max_stack];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const Node& node = nodes_[stack[--top]];
+			float t_enter;
+			if (!node.box.Raycast(origin, inv_direction, max_distance, t_enter)) {
+				continue;
+			}
+			if (node.count > 0) {
+				for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+					if (!items_[i].box.Raycast(origin, inv_direction, max_distance, t_enter)) {
+						continue;
+					}
+					float distance = callback(int(i), max_distance);
+					if (distance < max_distance) {
+						max_distance = distance;
+						closest = int(i);
+					}
+				}
+			}
+			else {
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+		}
+		return closest;
+	}
+
+private:
+	static const int max_stack = 64;
+	static const uint32_t max_leaf_items = 2;
+
+	struct Item {
+		AABB box;
+		T data;
+	};
+
+	// Same layout as the TriangleBVH nodes.
+	struct Node {
+		AABB box;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	// Median split along the longest axis of the centers, depth stays log2 of the item count.
+	void Subdivide(uint32_t node_index) {
+		uint32_t first = nodes_[node_index].first;
+		uint32_t count = nodes_[node_index].count;
+
+		AABB box;
+		AABB centers;
+		for (uint32_t i = first; i < first + count; ++i) {
+			box.Grow(items_[i].box);
+			centers.Grow(items_[i].box.Center());
+		}
+		nodes_[node_index].box = box;
+
+		if (count <= max_leaf_items) {
+			return;
+		}
+
+		glm::vec3 extent = centers.Extent();
+		int axis = 0;
+		if (extent.y > extent[axis]) axis = 1;
+		if (extent.z > extent[axis]) axis = 2;
+
+		uint32_t middle = first + count / 2;
+		std::nth_element(items_.begin() + first, items_.begin() + middle, items_.begin() + first + count,
+			[axis](const Item& a, const Item& b) {
+				return a.box.Center()[axis] < b.box.Center()[axis];
+			});
+
+		uint32_t left_index = uint32_t(nodes_.size());
+		nodes_.push_back(Node{ AABB(), first, middle - first });
+		nodes_.push_back(Node{ AABB(), middle, first + count - middle });
+		nodes_[node_index].first = left_index;
+		nodes_[node_index].count = 0;
+
+		Subdivide(left_index);
+		Subdivide(left_index + 1);
+	}
+
+	std::vector<Item> items_;
+	std::vector<Node> nodes_;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+#include "step_governor.hpp"
+
+StepGovernor::StepGovernor(double frame_length, double budget, int max_substeps, float max_travel)
+	: frame_length_(frame_length), budget_(budget), max_substeps_(std::max(max_substeps, 1)), max_travel_(max_travel),
+	frame_start_(Clock::now()) {}
+
+bool StepGovernor::BeginTick() {
+	tick_start_ = Clock::now();
+	std::chrono::duration<double> since = tick_start_ - frame_start_;
+	if (since.count() >= frame_length_) {
+		frame_start_ = tick_start_;
+		spent_ = 0.0;
+		over_ = false;
+		++stats_.frames;
+	}
+
+	// The first tick of a frame always runs, so the game keeps moving however slow ticks get.
+	if (spent_ > 0.0 && spent_ + average_ > budget_) {
+		if (!over_) {
+			over_ = true;
+			++stats_.overruns;
+		}
+		return false;
+	}
+	return true;
+}
+
+int StepGovernor::Substeps(float travel) {
+	int wanted = std::min(max_substeps_, std::max(1, int(std::ceil(travel / max_travel_))));
+	int substeps = spent_ > budget_ * 0.5 ? 1 : wanted;
+	if (substeps < wanted) {
+		++stats_.limited;
+	}
+	++stats_.ticks;
+	stats_.substeps += substeps;
+	stats_.max_substeps = std::max(stats_.max_substeps, substeps);
+	return substeps;
+}
+
+void StepGovernor::EndTick() {
+	std::chrono::duration<double> tick_time = Clock::now() - tick_start_;
+	spent_ += tick_time.count();
+	average_ = average_ == 0.0 ? tick_time.count() : average_ * 0.9 + tick_time.count() * 0.1;
+}
@@ -0,0 +1,61 @@
+#ifndef STEP_GOVERNOR_HPP
+#define STEP_GOVERNOR_HPP
+
+#include <chrono>
+#include <cstdint>
+
+struct GovernorStats {
+	uint64_t ticks = 0;
+	uint64_t substeps = 0;
+	// Most substeps any single tick was split into.
+	int max_substeps = 0;
+	// Ticks stepped coarser than their movement asked for, to stay in budget.
+	uint64_t limited = 0;
+	uint64_t frames = 0;
+	// Frames that ran out of budget and left ticks undone.
+	uint64_t overruns = 0;
+};
+
+// Decides how finely and how many ticks are stepped. A tick is split so nothing
+// moves further than max_travel times its own radius per substep. Tick work is
+// counted against a budget per frame of wall time: past half of it ticks are no
+// longer split (swept tests still catch tunnelling), once the next tick would not
+// fit the frame is over and the caller drops its backlog. The split a tick asks for
+// follows the state alone, the budget cutoff follows wall time, so runs under load
+// can differ. With an infinite budget every tick is split as its movement asks and
+// none is dropped, which is what recorded and replayed sessions use.
+class StepGovernor {
+public:
+	StepGovernor(double frame_length, double budget, int max_substeps, float max_travel);
+
+	// False if the current frame has no budget left for another tick.
+	bool BeginTick();
+
+	// Substeps for the tick just begun, travel is the largest distance an object
+	// covers over the whole tick measured in its own radii. One once the frame has
+	// spent half its budget.
+	int Substeps(float travel);
+
+	void EndTick();
+
+	const GovernorStats& Stats() const { return stats_; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double frame_length_;
+	double budget_;
+	int max_substeps_;
+	float max_travel_;
+
+	Clock::time_point frame_start_;
+	Clock::time_point tick_start_;
+	// Tick work done in the current frame, and a running average of one tick, in seconds.
+	double spent_ = 0.0;
+	double average_ = 0.0;
+	bool over_ = false;
+
+	GovernorStats stats_;
+};
+
+#endif
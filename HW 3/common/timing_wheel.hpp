@@ -0,0 +1,176 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <vector>
+#include <cstdint>
+
+// Hierarchical timing wheel: timers are kept in slots by due time instead of being
+// compared every tick. Level 0 has one slot per time unit, each higher level one
+// per whole turn of the level below. Timers move down a level when time reaches
+// their slot, so advancing costs one step per unit plus the timers that fall due.
+template <typename T>
+class TimingWheel {
+public:
+	typedef uint32_t TimerId;
+	static const TimerId null_timer = 0xffffffffu;
+
+	explicit TimingWheel(uint64_t now = 0) { Clear(now); }
+
+	uint64_t Now() const { return now_; }
+	size_t Size() const { return size_; }
+
+	// Fires at the first Advance reaching due, at the next one if due already passed.
+	TimerId Schedule(uint64_t due, const T& data) {
+		TimerId id;
+		if (free_list_ != null_timer) {
+			id = free_list_;
+			free_list_ = timers_[id].next;
+		}
+		else {
+			id = TimerId(timers_.size());
+			timers_.push_back(Timer());
+		}
+		timers_[id].due = due;
+		timers_[id].data = data;
+		Place(id);
+		++size_;
+		return id;
+	}
+
+	// The id must belong to a timer that has not fired yet.
+	void Cancel(TimerId id) {
+		Unlink(id);
+		Free(id);
+		--size_;
+	}
+
+	// Moves time to now, calling fire(data) for every timer due by then, earliest first.
+	// Timers scheduled from fire for a time already reached wait for the next Advance.
+	template <typename F>
+	void Advance(uint64_t now, F&& fire) {
+		FireList(overdue_list, fire);
+		while (now_ < now) {
+			++now_;
+			if ((now_ & overflow_mask) == 0) {
+				Cascade(overflow_list);
+			}
+			for (int level = levels - 1; level > 0; --level) {
+				if ((now_ & ((uint64_t(1) << (slot_bits * level)) - 1)) == 0) {
+					Cascade(level * slots + int((now_ >> (slot_bits * level)) & slot_mask));
+				}
+			}
+			FireList(int(now_ & slot_mask), fire);
+		}
+	}
+
+	void Clear(uint64_t now) {
+		timers_.clear();
+		heads_.assign(list_count, TimerId(null_timer));
+		free_list_ = null_timer;
+		now_ = now;
+		size_ = 0;
+	}
+
+private:
+	static const int slot_bits = 6;
+	static const int slots = 1 << slot_bits;
+	static const uint64_t slot_mask = slots - 1;
+	static const int levels = 4;
+	static const uint64_t overflow_mask = (uint64_t(1) << (slot_bits * levels)) - 1;
+	// Slot lists of all levels, then timers already due, timers beyond the top level
+	// and the timers being fired.
+	static const int overdue_list = levels * slots;
+	static const int overflow_list = overdue_list + 1;
+	static const int firing_list = overflow_list + 1;
+	static const int list_count = firing_list + 1;
+
+	struct Timer {
+		uint64_t due = 0;
+		T data = T();
+		// Neighbours in the slot list, next free timer for free ones.
+		TimerId prev = null_timer;
+		TimerId next = null_timer;
+		int list = -1;
+	};
+
+	// The level is the highest group of bits in which due and now differ, so a timer
+	// reaches level 0 exactly when the rest of now has caught up with it.
+	int ListFor(uint64_t due) const {
+		if (due <= now_) {
+			return overdue_list;
+		}
+		uint64_t diff = due ^ now_;
+		for (int level = 0; level < levels; ++level) {
+			if ((diff >> (slot_bits * (level + 1))) == 0) {
+				return level * slots + int((due >> (slot_bits * level)) & slot_mask);
+			}
+		}
+		return overflow_list;
+	}
+
+	void Place(TimerId id) {
+		int list = ListFor(timers_[id].due);
+		Timer& timer = timers_[id];
+		timer.list = list;
+		timer.prev = null_timer;
+		timer.next = heads_[list];
+		if (heads_[list] != null_timer) {
+			timers_[heads_[list]].prev = id;
+		}
+		heads_[list] = id;
+	}
+
+	void Unlink(TimerId id) {
+		Timer& timer = timers_[id];
+		if (timer.prev != null_timer) {
+			timers_[timer.prev].next = timer.next;
+		}
+		else {
+			heads_[timer.list] = timer.next;
+		}
+		if (timer.next != null_timer) {
+			timers_[timer.next].prev = timer.prev;
+		}
+		timer.list = -1;
+	}
+
+	void Free(TimerId id) {
+		timers_[id].data = T();
+		timers_[id].next = free_list_;
+		free_list_ = id;
+	}
+
+	void Cascade(int list) {
+		TimerId id = heads_[list];
+		heads_[list] = null_timer;
+		while (id != null_timer) {
+			TimerId next = timers_[id].next;
+			Place(id);
+			id = next;
+		}
+	}
+
+	// The list is moved aside first, so fire may schedule and cancel timers freely.
+	template <typename F>
+	void FireList(int list, F& fire) {
+		heads_[firing_list] = heads_[list];
+		heads_[list] = null_timer;
+		for (TimerId id = heads_[firing_list]; id != null_timer; id = timers_[id].next) {
+			timers_[id].list = firing_list;
+		}
+		while (heads_[firing_list] != null_timer) {
+			TimerId id = heads_[firing_list];
+			T data = timers_[id].data;
+			Cancel(id);
+			fire(data);
+		}
+	}
+
+	std::vector<Timer> timers_;
+	std::vector<TimerId> heads_;
+	TimerId free_list_ = null_timer;
+	uint64_t now_ = 0;
+	size_t size_ = 0;
+};
+
+#endif
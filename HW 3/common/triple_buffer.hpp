@@ -0,0 +1,42 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+
+// Hands the latest value from one writer thread to one reader thread without locks.
+// The writer fills one slot while the reader holds another, the third is the last
+// published one. Publishing and taking are single exchanges of the middle slot,
+// so neither side ever waits, the reader simply skips values it was too slow for.
+template <typename T>
+class TripleBuffer {
+public:
+	// Slot the writer owns until Publish.
+	T& WriteBuffer() { return slots_[write_]; }
+
+	void Publish() {
+		write_ = latest_.exchange(write_ | fresh_bit, std::memory_order_acq_rel) & index_mask;
+	}
+
+	// Takes the last published value if it was not taken yet, false otherwise.
+	bool Update() {
+		if ((latest_.load(std::memory_order_relaxed) & fresh_bit) == 0) {
+			return false;
+		}
+		read_ = latest_.exchange(read_, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+
+	// Slot the reader owns until the next successful Update.
+	const T& ReadBuffer() const { return slots_[read_]; }
+
+private:
+	static const int index_mask = 3;
+	static const int fresh_bit = 4;
+
+	T slots_[3];
+	int write_ = 0;
+	std::atomic<int> latest_{ 1 };
+	int read_ = 2;
+};
+
+#endif
@@ -8,7 +8,19 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <cfloat>
 #include <random>
+#include <array>
+#include <utility>
+#include <future>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <map>
+#include <limits>
+#include <cstring>
 
 #include <GL/glew.h>
 
@@ -24,67 +36,206 @@ GLFWwindow* window;
 #include <common/texture.hpp>
 #include <common/objloader.hpp>
 #include <common/text2D.hpp>
+#include <common/bvh.hpp>
+#include <common/ccd.hpp>
+#include <common/aabb_tree.hpp>
+#include <common/static_index.hpp>
+#include <common/narrowphase.hpp>
+#include <common/projectile_kernel.hpp>
+#include <common/job_system.hpp>
+#include <common/triple_buffer.hpp>
+#include <common/step_governor.hpp>
+#include <common/timing_wheel.hpp>
+#include <common/object_pool.hpp>
+#include <common/handle_table.hpp>
+#include <common/ai_scheduler.hpp>
+#include <common/flow_field.hpp>
+#include <common/crowd.hpp>
+#include <common/behaviour.hpp>
+#include <common/poisson_disk.hpp>
+#include <common/spawn_director.hpp>
+#include <common/save_file.hpp>
+#include <common/save_writer.hpp>
+#include <common/snapshot_ring.hpp>
+#include <common/input_log.hpp>
 
 static const int ShaderNum = 25;
 static const int h = 768;
 static const int w = 1024;
 static const GLfloat time_coef = 10.0f;
 static const GLfloat max_distance = 300.0f;
+// Swept contacts stop this fraction of the radius inside the target, so the discrete test sees them.
+static const GLfloat ccd_penetration = 0.01f;
+// Objects per job in the parallel stages of a frame.
+static const size_t job_grain = 64;
+// Simulation ticks per second unless --tick-rate says otherwise, the render thread
+// draws at its own rate and interpolates between the last two ticks.
+static const double default_tick_rate = 60.0;
+// Ticks a late frame may catch up on, time beyond that is dropped instead of
+// making every following frame late as well.
+static const int max_catch_up_ticks = 5;
+// Wall time of simulation work allowed per frame of default_tick_rate, and how
+// finely a tick may be split so fast objects move at most one diameter per substep.
+static const double sim_budget = 0.008;
+static const int max_substeps = 8;
+static const GLfloat max_substep_travel = 2.0f;
+// Enemies within this distance of the player think every tick, see AiScheduler,
+// and the wall time their updates may take per tick.
+static const GLfloat ai_near_distance = 10.0f;
+static const double ai_budget = 0.002;
+// Flow field around the player for the enemies: cells per side and their size, how far
+// paths keep off static colliders and the radius they are grown by for the enemies.
+// A field is used this many ticks after it was asked for.
+static const int flow_size = 128;
+static const GLfloat flow_cell = 1.0f;
+static const GLfloat flow_margin = 1.0f;
+static const GLfloat flow_agent_radius = 1.0f;
+static const uint64_t flow_latency = 2;
+// Enemies keep this gap to each other and to static colliders. How much the push away
+// weighs against the way to the player, and how much more colliders push than enemies.
+static const GLfloat crowd_spacing = 1.0f;
+static const GLfloat separation_weight = 1.5f;
+static const GLfloat obstacle_weight = 2.0f;
+// Radius of spawned objects, and how far apart the spawn spots of one Poisson disk set are,
+// so spawns in a row spread round the player.
+static const GLfloat spawn_radius = 1.0f;
+static const GLfloat spawn_spacing = 4.0f;
+// Wall time drawing a frame may take before spawning slows down, and the most objects
+// spawning goes up to, see SpawnDirector.
+static const double render_budget = 0.012;
+static const size_t max_live_objects = 2000;
+
+// Game seconds between autosaves. The game thread only copies the records, the rest is written behind it.
+static const double autosave_interval = 60.0;
+
+// Rewind snapshots every object each tick, whole once a second of ticks and as deltas
+// in between, in at most rewind_memory bytes. R goes back rewind_seconds.
+static const size_t rewind_memory = size_t(64) << 20;
+static const size_t rewind_keyframe_every = 60;
+static const double rewind_seconds = 5.0;
+
+// Simulation time in seconds. Advances by exactly one tick length per tick, every
+// cooldown and lifetime is measured against it, never against the wall clock.
+static double game_time = 0.0;
+
+double GameTime() {
+	return game_time;
+}
 
-class LoadedModel {
+class Timed;
+typedef TimingWheel<Timed*> Timers;
+
+// Something with one pending timer at most: a cooldown, a lifetime or a spawn.
+class Timed {
 public:
-	explicit LoadedModel(const std::string& obj_file, const std::string& texture_file) {
-		texture_ = loadDDS(texture_file.data());
-		loadOBJ(obj_file.data(), vertices_, uvs_, normals_);
-	}
-	virtual ~LoadedModel() {
-		glDeleteTextures(1, &texture_);
-	}
+	virtual ~Timed();
+	// Called once the time given to ScheduleTimer was reached, now is the game time of the step.
+	virtual void OnTimer(GLfloat now) = 0;
+	Timers::TimerId Timer() { return timer_; }
+	void SetTimer(Timers::TimerId timer) { timer_ = timer; }
 
-	void DrawShader(GLuint texture_id, GLuint vertexbuffer, GLuint uvbuffer, GLuint normalbuffer) {
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(glm::vec3), &vertices_[0], GL_STATIC_DRAW);
+private:
+	Timers::TimerId timer_ = Timers::null_timer;
+};
 
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glBufferData(GL_ARRAY_BUFFER, uvs_.size() * sizeof(glm::vec3), &uvs_[0], GL_STATIC_DRAW);
+// Timers of everything in the game, in milliseconds of game time. Each step only touches
+// the timers falling due instead of every object comparing its own. Objects schedule from
+// jobs, hence the lock. The offset keeps the wheel going forward when a load moves game time back.
+static Timers timers;
+static std::mutex timers_mutex;
+static int64_t timer_offset = 0;
 
-		glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-		glBufferData(GL_ARRAY_BUFFER, normals_.size() * sizeof(glm::vec3), &normals_[0], GL_STATIC_DRAW);
+uint64_t TimerTime(double time) {
+	return uint64_t(std::max<int64_t>(0, int64_t(std::ceil(std::max(time, 0.0) * 1000.0)) + timer_offset));
+}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture_);
-		glUniform1i(texture_id, 0);
+// Replaces the pending timer of target, FLT_MAX only cancels it.
+void ScheduleTimer(Timed* target, GLfloat time) {
+	std::lock_guard<std::mutex> lock(timers_mutex);
+	if (target->Timer() != Timers::null_timer) {
+		timers.Cancel(target->Timer());
+		target->SetTimer(Timers::null_timer);
+	}
+	if (time < FLT_MAX) {
+		target->SetTimer(timers.Schedule(TimerTime(time), target));
+	}
+}
 
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+Timed::~Timed() {
+	if (timer_ != Timers::null_timer) {
+		ScheduleTimer(this, FLT_MAX);
+	}
+}
 
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uvbuffer);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+// Fires every timer due by now. Called between the parallel stages, OnTimer may schedule again.
+void AdvanceTimers(double now) {
+	uint64_t wheel_now = uint64_t(std::max<int64_t>(0, int64_t(std::floor(now * 1000.0)) + timer_offset));
+	timers.Advance(wheel_now, [now](Timed* target) {
+		target->SetTimer(Timers::null_timer);
+		target->OnTimer(GLfloat(now));
+	});
+}
 
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normalbuffer);
-		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+// Game time jumps to now, pending timers keep the time they had left.
+void RebaseTimers(double now) {
+	timer_offset = int64_t(timers.Now()) - int64_t(std::floor(now * 1000.0));
+}
 
-		glDrawArrays(GL_TRIANGLES, 0, vertices_.size());
+// Geometry and texture name of a model, shared by every object using it. Never changed
+// once loaded, so frame snapshots can keep it alive while the render thread draws it.
+struct Mesh {
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::string texture_file;
+};
 
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+// Reads every obj file once. Objects are created in jobs, so the cache is locked.
+std::shared_ptr<const Mesh> LoadMesh(const std::string& obj_file, const std::string& texture_file) {
+	static std::mutex mutex;
+	static std::map<std::pair<std::string, std::string>, std::shared_ptr<const Mesh>> meshes;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<const Mesh>& mesh = meshes[std::make_pair(obj_file, texture_file)];
+	if (mesh == nullptr) {
+		std::shared_ptr<Mesh> loaded = std::make_shared<Mesh>();
+		loadOBJ(obj_file.data(), loaded->vertices, loaded->uvs, loaded->normals);
+		loaded->texture_file = texture_file;
+		mesh = loaded;
 	}
+	return mesh;
+}
 
-	virtual void Draw(GLuint texture_id, GLuint vertexbuffer, GLuint uvbuffer, GLuint normalbuffer) {
-		DrawShader(texture_id, vertexbuffer, uvbuffer, normalbuffer);
-	}
+class LoadedModel {
+public:
+	explicit LoadedModel(const std::string& obj_file, const std::string& texture_file)
+		: mesh_(LoadMesh(obj_file, texture_file)) {}
+	virtual ~LoadedModel() = default;
+
+	const std::shared_ptr<const Mesh>& GetMesh() { return mesh_; }
 
 protected:
-	GLuint texture_;
-	std::vector<glm::vec3> vertices_;
-	std::vector<glm::vec2> uvs_;
-	std::vector<glm::vec3> normals_;
+	std::shared_ptr<const Mesh> mesh_;
 };
 
+// One object in a binary save. Every type fills the common part and its own values, the
+// layout is fixed so the records of a save are one array. Changing it needs a new save_version.
+struct ObjectRecord {
+	uint32_t type;
+	uint32_t flags;
+	float position[3];
+	float direction[3];
+	float box;
+	float speed;
+	float hp;
+	uint32_t count;
+	float values[8];
+};
+
+static_assert(sizeof(ObjectRecord) == 80, "object record layout changed");
+
+static const uint32_t save_version = 1;
+
 class Camera {
 public:
 	explicit Camera(GLfloat horizontal_angle = 0.0f, GLfloat vertical_angle = 0.0f, GLfloat fov = 45.0f)
@@ -98,6 +249,19 @@ public:
 		file >> horizontal_angle_ >> vertical_angle_ >> fov_;
 	}
 
+	// Values 0 to 2 of the record.
+	void Write(ObjectRecord& record) {
+		record.values[0] = horizontal_angle_;
+		record.values[1] = vertical_angle_;
+		record.values[2] = fov_;
+	}
+
+	void Read(const ObjectRecord& record) {
+		horizontal_angle_ = record.values[0];
+		vertical_angle_ = record.values[1];
+		fov_ = record.values[2];
+	}
+
 	virtual ~Camera() = default;
 
 	virtual glm::vec3 CameraDirection() {
@@ -130,12 +294,43 @@ protected:
 	GLfloat fov_;
 };
 
-class Object : public LoadedModel {
+// Concrete kind of an object, stored in it so hot paths never need RTTI.
+// The first five values are the type ids of the save file.
+enum class ObjectType : unsigned char {
+	Player,
+	Dummy,
+	Enemy,
+	Projectile,
+	Floor,
+	Skybox,
+	Count
+};
+
+static const size_t object_type_count = size_t(ObjectType::Count);
+
+constexpr bool IsActor(ObjectType type) {
+	return type == ObjectType::Player || type == ObjectType::Dummy || type == ObjectType::Enemy;
+}
+
+constexpr bool IsEnemy(ObjectType type) {
+	return type == ObjectType::Dummy || type == ObjectType::Enemy;
+}
+
+// Types with an AI in Act, run at the level of detail the AiScheduler gives them.
+// Act of the other types does nothing, except for the player's.
+constexpr bool HasAi(ObjectType type) {
+	return type == ObjectType::Enemy;
+}
+
+class World;
+class CommandWriter;
+
+class Object : public LoadedModel, public Timed {
 public:
-	explicit Object(const glm::vec3& position, const glm::vec3& direction,
+	explicit Object(ObjectType type, const glm::vec3& position, const glm::vec3& direction,
 		GLfloat box, GLfloat speed,
 		const std::string& obj_file, const std::string& texture_file)
-		: position_(position), direction_(direction), box_(box), speed_(speed), 
+		: type_(type), position_(position), previous_position_(position), direction_(direction), box_(box), speed_(speed), 
 		LoadedModel(obj_file, texture_file) {}
 
 	virtual void Save(std::iostream& file) {
@@ -148,77 +343,689 @@ public:
 		file >> position_.x >> position_.y >> position_.z;
 		file >> direction_.x >> direction_.y >> direction_.z;
 		file >> box_ >> speed_;
+		previous_position_ = position_;
+	}
+
+	// The same for binary saves, the record arrives zeroed.
+	virtual void Write(ObjectRecord& record) {
+		record.type = uint32_t(type_);
+		for (int i = 0; i < 3; ++i) {
+			record.position[i] = position_[i];
+			record.direction[i] = direction_[i];
+		}
+		record.box = box_;
+		record.speed = speed_;
+	}
+
+	virtual void Read(const ObjectRecord& record) {
+		for (int i = 0; i < 3; ++i) {
+			position_[i] = record.position[i];
+			direction_[i] = record.direction[i];
+		}
+		box_ = record.box;
+		speed_ = record.speed;
+		previous_position_ = position_;
 	}
 
 	virtual ~Object() = default;
-	virtual bool Interract(Object* obj, const glm::vec3& old_position) = 0;
+	ObjectType Type() { return type_; }
 	virtual bool CheckInterraction(Object* obj) {
-		return glm::length(position_ - obj->Position()) < (box_ + obj->Box());
+		glm::vec3 diff = position_ - obj->Position();
+		GLfloat radius = box_ + obj->Box();
+		return glm::dot(diff, diff) < radius * radius;
+	}
+	virtual bool SphereShape() { return true; }
+	// Whether a sphere would touch this object, so a spot can be tested before anything is made for it.
+	virtual bool OverlapSphere(const glm::vec3& center, GLfloat radius) {
+		glm::vec3 diff = position_ - center;
+		GLfloat reach = box_ + radius;
+		return glm::dot(diff, diff) < reach * reach;
+	}
+	// Static objects never move, so they are left out of movement, Act and static-static collision.
+	virtual bool Static() { return false; }
+	// Time of first contact within this step, for sphere shaped obj only. Pairs whose relative
+	// move is shorter than their radii cannot pass through each other and are left to CheckInterraction.
+	virtual bool Sweep(Object* obj, const glm::vec3& old_position, const glm::vec3& obj_old_position, GLfloat& toi) {
+		glm::vec3 move = position_ - old_position;
+		glm::vec3 obj_move = obj->Position() - obj_old_position;
+		GLfloat radius = box_ + obj->Box();
+		if (glm::length(move - obj_move) < radius) {
+			return false;
+		}
+		return SweepSpheres(old_position, move, obj_old_position, obj_move, radius * (1.0f - ccd_penetration), toi);
+	}
+	virtual AABB Bounds() { return AABB::FromSphere(position_, box_); }
+	// Direction must be normalized.
+	virtual bool Raycast(const glm::vec3& origin, const glm::vec3& direction, GLfloat max_distance, RayHit& hit) {
+		glm::vec3 diff = position_ - origin;
+		GLfloat b = glm::dot(diff, direction);
+		GLfloat c = glm::dot(diff, diff) - box_ * box_;
+		GLfloat discriminant = b * b - c;
+		if ((c > 0.0f && b < 0.0f) || discriminant < 0.0f) {
+			return false;
+		}
+
+		GLfloat t = std::max(0.0f, b - std::sqrt(discriminant));
+		if (t > max_distance) {
+			return false;
+		}
+
+		hit.distance = t;
+		hit.point = origin + direction * t;
+		hit.normal = hit.point - position_;
+		if (glm::length(hit.normal) > 0.0f) {
+			hit.normal /= glm::length(hit.normal);
+		}
+		hit.triangle = 0;
+		return true;
 	}
 	glm::vec3 Position() { return position_; }
+	// Position before the last tick, frames are drawn between the two.
+	glm::vec3 PreviousPosition() { return previous_position_; }
+	void StartTick() { previous_position_ = position_; }
 	virtual bool CheckSelf() { return true; }
+	// Game time at which OnTimer is due, FLT_MAX for never. Scheduled when the object is added.
+	virtual GLfloat Deadline() { return FLT_MAX; }
+	void OnTimer(GLfloat now) override {}
 	virtual glm::vec3 GetDirection() { return direction_;  };
 	float GetSpeed() { return speed_; }
 	void Move(const glm::vec3& move) { position_ += move; }
-	virtual Object* Act(const std::vector<Object*>& objects) = 0;
+	void MoveTo(const glm::vec3& position) { position_ = position; }
+	// Spawns and removals go to commands, they are applied once every object has acted.
+	virtual void Act(World& world, CommandWriter& commands) = 0;
 	GLfloat Box() { return box_; }
+	int Proxy() { return proxy_; }
+	void SetProxy(int proxy) { proxy_ = proxy; }
+	Handle GetHandle() { return handle_; }
+	void SetHandle(Handle handle) { handle_ = handle; }
 
 protected:
+	const ObjectType type_;
 	glm::vec3 position_;
+	glm::vec3 previous_position_;
 	glm::vec3 direction_;
 	GLfloat box_;
 	GLfloat speed_;
+	int proxy_ = -1;
+	Handle handle_;
+};
+
+// Time of impact of a against b during this step. A non-sphere shape (the floor)
+// sweeps the other object against itself.
+bool SweepPair(Object* a, const glm::vec3& a_old, Object* b, const glm::vec3& b_old, GLfloat& toi) {
+	if (a->SphereShape()) {
+		return b->Sweep(a, b_old, a_old, toi);
+	}
+	return a->Sweep(b, a_old, b_old, toi);
+}
+
+// Effect of other on obj found by one pair test. Pair tests only read, the contacts of all
+// pairs are applied afterwards in (obj, other) order, so the outcome does not depend on
+// how the tests were spread over threads. Indices count moving objects, then static ones.
+struct Contact {
+	uint32_t obj;
+	uint32_t other;
+	GLfloat damage;
+	// Move obj back to where it was before this step.
+	bool blocked;
+
+	bool operator<(const Contact& contact) const {
+		return obj < contact.obj || (obj == contact.obj && other < contact.other);
+	}
+};
+
+// Spawn (spawn set) or removal (destroy set) asked for by the object at index source.
+struct Command {
+	uint32_t source;
+	uint32_t order;
+	Object* spawn;
+	Object* destroy;
+
+	bool operator<(const Command& command) const {
+		return source < command.source || (source == command.source && order < command.order);
+	}
+};
+
+// Commands of one object, written from the thread it acts on.
+class CommandWriter {
+public:
+	CommandWriter(std::vector<Command>& list, uint32_t source) : list_(list), source_(source) {}
+
+	void Spawn(Object* obj) {
+		list_.push_back(Command{ source_, order_++, obj, nullptr });
+	}
+
+	void Destroy(Object* obj) {
+		list_.push_back(Command{ source_, order_++, nullptr, obj });
+	}
+
+private:
+	std::vector<Command>& list_;
+	uint32_t source_;
+	uint32_t order_ = 0;
+};
+
+// Commands collected while objects act in jobs, one list per thread. World::Apply takes
+// them in (source, order) order, so the outcome does not depend on how jobs were spread.
+class CommandBuffer {
+public:
+	explicit CommandBuffer(size_t threads) : lists_(threads) {}
+
+	// For the object at index source, on the calling thread only.
+	CommandWriter Writer(uint32_t source) {
+		return CommandWriter(lists_[JobSystem::ThreadIndex()], source);
+	}
+
+	// Moves all commands into out, sorted.
+	void Take(std::vector<Command>& out) {
+		out.clear();
+		for (std::vector<Command>& list : lists_) {
+			out.insert(out.end(), list.begin(), list.end());
+			list.clear();
+		}
+		std::sort(out.begin(), out.end());
+	}
+
+private:
+	std::vector<std::vector<Command>> lists_;
+};
+
+// All objects of the level, split by whether they ever move.
+// Moving objects live in a dynamic tree refitted every frame, their tree data is
+// their index in objects. Static ones go to an index rebuilt only when one is added
+// or removed, they are never moved, never collided with each other and never Act.
+class World {
+public:
+	// Handles stay valid while the object lives, wherever removals move it to.
+	Handle Add(Object* obj) {
+		ScheduleTimer(obj, obj->Deadline());
+		if (obj->Static()) {
+			obj->SetHandle(handles_.Create(uint32_t(static_objects.size()) | static_position));
+			static_objects.push_back(obj);
+			static_dirty_ = true;
+			++static_version_;
+		}
+		else {
+			obj->SetHandle(handles_.Create(uint32_t(objects.size())));
+			obj->SetProxy(tree_.CreateProxy(obj->Bounds(), objects.size()));
+			objects.push_back(obj);
+		}
+		return obj->GetHandle();
+	}
+
+	// Object of a handle that must still be alive, debug builds stop on stale ones.
+	Object* Get(Handle handle) {
+		return At(handles_.Position(handle));
+	}
+
+	// Object of a handle, null if it was removed.
+	Object* Find(Handle handle) {
+		uint32_t position = handles_.Find(handle);
+		return position == HandleTable::null_position ? nullptr : At(position);
+	}
+
+	// Deletes everything, handles to it stay invalid for good.
+	void Clear() {
+		for (Object* obj : objects) {
+			delete obj;
+		}
+		for (Object* obj : static_objects) {
+			delete obj;
+		}
+		objects.clear();
+		static_objects.clear();
+		tree_.Clear();
+		handles_.Clear();
+		static_dirty_ = true;
+		++static_version_;
+	}
+
+	// Deletes the moving objects and keeps the static ones, for rewinds.
+	void ClearMoving() {
+		for (Object* obj : objects) {
+			handles_.Destroy(obj->GetHandle());
+			delete obj;
+		}
+		objects.clear();
+		tree_.Clear();
+	}
+
+	size_t Size() {
+		return objects.size() + static_objects.size();
+	}
+
+	template <typename F>
+	void ForEach(F f) {
+		for (Object* obj : objects) {
+			f(obj);
+		}
+		for (Object* obj : static_objects) {
+			f(obj);
+		}
+	}
+
+	// Stretches the tree boxes over the whole move so pairs can be found for the sweep.
+	void RefitSwept(const std::vector<glm::vec3>& old_positions) {
+		for (size_t i = 0; i < objects.size(); ++i) {
+			glm::vec3 displacement = objects[i]->Position() - old_positions[i];
+			tree_.MoveProxy(objects[i]->Proxy(), SweptBounds(objects[i], displacement), displacement);
+		}
+	}
+
+	// Back to the real bounds once collision settled the positions.
+	void Refit(const std::vector<glm::vec3>& old_positions) {
+		for (size_t i = 0; i < objects.size(); ++i) {
+			tree_.MoveProxy(objects[i]->Proxy(), objects[i]->Bounds(), objects[i]->Position() - old_positions[i]);
+		}
+	}
+
+	// Sorted pairs i < j of moving objects whose swept boxes touch.
+	std::vector<std::pair<size_t, size_t>> DynamicPairs() {
+		std::vector<std::pair<size_t, size_t>> pairs;
+		for (size_t i = 0; i < objects.size(); ++i) {
+			tree_.Query(tree_.TightBox(objects[i]->Proxy()), [&](int proxy) {
+				size_t j = tree_.Data(proxy);
+				if (j > i) {
+					pairs.push_back(std::make_pair(i, j));
+				}
+				return true;
+			});
+		}
+		std::sort(pairs.begin(), pairs.end());
+		return pairs;
+	}
+
+	// Sorted pairs (moving index, static index) whose swept and static boxes touch.
+	std::vector<std::pair<size_t, size_t>> StaticPairs() {
+		const StaticIndex<size_t>& index = Statics();
+		std::vector<std::pair<size_t, size_t>> pairs;
+		for (size_t i = 0; i < objects.size(); ++i) {
+			index.Query(tree_.TightBox(objects[i]->Proxy()), [&](int id) {
+				pairs.push_back(std::make_pair(i, index.Data(id)));
+			});
+		}
+		std::sort(pairs.begin(), pairs.end());
+		return pairs;
+	}
+
+	// Deletes objects whose remains flag is false, calling on_remove first.
+	// Flags are chars rather than vector<bool> bits, so jobs can set them side by side.
+	template <typename F>
+	void RemoveDead(const std::vector<char>& remains, const std::vector<char>& static_remains, F on_remove) {
+		for (size_t i = objects.size(); i-- > 0;) {
+			if (!remains[i]) {
+				RemoveAt(i, on_remove);
+			}
+		}
+		for (size_t i = static_objects.size(); i-- > 0;) {
+			if (!static_remains[i]) {
+				RemoveStaticAt(i, on_remove);
+			}
+		}
+	}
+
+	// Carries out the buffered commands: removals first, then spawns in command order.
+	// An object destroyed twice is removed once.
+	template <typename F>
+	void Apply(CommandBuffer& buffer, F on_remove) {
+		buffer.Take(commands_);
+
+		removed_.clear();
+		static_removed_.clear();
+		for (const Command& command : commands_) {
+			if (command.destroy == nullptr) {
+				continue;
+			}
+			if (command.destroy->Static()) {
+				static_removed_.push_back(std::find(static_objects.begin(), static_objects.end(), command.destroy) - static_objects.begin());
+			}
+			else {
+				removed_.push_back(tree_.Data(command.destroy->Proxy()));
+			}
+		}
+		RemoveIndices(removed_, [&](size_t i) { RemoveAt(i, on_remove); });
+		RemoveIndices(static_removed_, [&](size_t i) { RemoveStaticAt(i, on_remove); });
+
+		for (const Command& command : commands_) {
+			if (command.spawn != nullptr) {
+				Add(command.spawn);
+			}
+		}
+	}
+
+	// Objects touching the sphere.
+	std::vector<Object*> QueryRadius(const glm::vec3& center, GLfloat radius) {
+		std::vector<Object*> result;
+		std::vector<int> proxies;
+
+		tree_.QueryRadius(center, radius, proxies);
+		for (int proxy : proxies) {
+			AddIfTouching(objects[tree_.Data(proxy)], center, radius, result);
+		}
+
+		proxies.clear();
+		const StaticIndex<size_t>& index = Statics();
+		index.QueryRadius(center, radius, proxies);
+		for (int id : proxies) {
+			AddIfTouching(static_objects[index.Data(id)], center, radius, result);
+		}
+		return result;
+	}
+
+	// True if a sphere at center touches nothing, tested on the spot alone.
+	bool SpotFree(const glm::vec3& center, GLfloat radius) {
+		for (Object* obj : QueryRadius(center, radius)) {
+			if (obj->OverlapSphere(center, radius)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Up to k objects accepted by filter, nearest bounds first.
+	template <typename F>
+	std::vector<Object*> QueryKNearest(const glm::vec3& center, size_t k, F filter) {
+		std::vector<std::pair<float, Object*>> found;
+
+		std::vector<int> proxies;
+		tree_.QueryKNearest(center, k, proxies, [&](size_t i) { return filter(objects[i]); });
+		for (int proxy : proxies) {
+			found.push_back(std::make_pair(tree_.TightBox(proxy).DistanceSquared(center), objects[tree_.Data(proxy)]));
+		}
+
+		std::vector<std::pair<float, int>> statics;
+		const StaticIndex<size_t>& index = Statics();
+		index.QueryKNearest(center, k, statics, [&](size_t i) { return filter(static_objects[i]); });
+		for (const std::pair<float, int>& entry : statics) {
+			found.push_back(std::make_pair(entry.first, static_objects[index.Data(entry.second)]));
+		}
+
+		std::stable_sort(found.begin(), found.end(),
+			[](const std::pair<float, Object*>& a, const std::pair<float, Object*>& b) { return a.first < b.first; });
+
+		std::vector<Object*> result;
+		for (size_t i = 0; i < found.size() && i < k; ++i) {
+			result.push_back(found[i].second);
+		}
+		return result;
+	}
+
+	// Queries rebuild the static index lazily, this does it up front so jobs can query at the same time.
+	void PrepareQueries() {
+		Statics();
+	}
+
+	// Changes whenever a static object is added or removed.
+	uint64_t StaticVersion() { return static_version_; }
+
+	// Way to the player for enemies, null until the first field is done.
+	const FlowField* Flow() { return flow_; }
+	void SetFlow(const FlowField* flow) { flow_ = flow; }
+
+	// Closest object hit by the ray, nullptr if none. Direction must be normalized.
+	Object* Raycast(const glm::vec3& origin, const glm::vec3& direction, GLfloat max_distance, RayHit& hit) {
+		Object* closest = RaycastStatic(origin, direction, max_distance, hit);
+		if (closest != nullptr) {
+			max_distance = hit.distance;
+		}
+		tree_.Raycast(origin, direction, max_distance, [&](int proxy, GLfloat max_t) {
+			return TestRay(objects[tree_.Data(proxy)], origin, direction, max_t, hit, closest);
+		});
+		return closest;
+	}
+
+	// The same over static objects only, enough for sight lines that moving objects don't block.
+	Object* RaycastStatic(const glm::vec3& origin, const glm::vec3& direction, GLfloat max_distance, RayHit& hit) {
+		Object* closest = nullptr;
+		const StaticIndex<size_t>& index = Statics();
+		index.Raycast(origin, direction, max_distance, [&](int id, GLfloat max_t) {
+			return TestRay(static_objects[index.Data(id)], origin, direction, max_t, hit, closest);
+		});
+		return closest;
+	}
+
+	// Moving objects, objects[0] is the player.
+	std::vector<Object*> objects;
+	std::vector<Object*> static_objects;
+
+private:
+	// Handle positions of static objects have this bit set.
+	static const uint32_t static_position = 0x80000000u;
+
+	Object* At(uint32_t position) {
+		return position & static_position ? static_objects[position & ~static_position] : objects[position];
+	}
+
+	// New bound for the ray, shortened if obj is hit before max_t.
+	static GLfloat TestRay(Object* obj, const glm::vec3& origin, const glm::vec3& direction, GLfloat max_t,
+		RayHit& hit, Object*& closest) {
+		RayHit obj_hit;
+		if (obj->Raycast(origin, direction, max_t, obj_hit) && obj_hit.distance < max_t) {
+			hit = obj_hit;
+			closest = obj;
+			return obj_hit.distance;
+		}
+		return max_t;
+	}
+
+	// Swap with the last object and pop, only the moved object changes its index.
+	template <typename F>
+	void RemoveAt(size_t i, F& on_remove) {
+		Object* obj = objects[i];
+		on_remove(obj);
+		handles_.Destroy(obj->GetHandle());
+		tree_.DestroyProxy(obj->Proxy());
+		delete obj;
+		objects[i] = objects.back();
+		objects.pop_back();
+		if (i < objects.size()) {
+			tree_.SetData(objects[i]->Proxy(), i);
+			handles_.Move(objects[i]->GetHandle(), uint32_t(i));
+		}
+	}
+
+	template <typename F>
+	void RemoveStaticAt(size_t i, F& on_remove) {
+		Object* obj = static_objects[i];
+		on_remove(obj);
+		handles_.Destroy(obj->GetHandle());
+		delete obj;
+		static_objects[i] = static_objects.back();
+		static_objects.pop_back();
+		if (i < static_objects.size()) {
+			handles_.Move(static_objects[i]->GetHandle(), uint32_t(i) | static_position);
+		}
+		static_dirty_ = true;
+		++static_version_;
+	}
+
+	// Highest index first, so swapping never moves an object still to be removed.
+	template <typename F>
+	static void RemoveIndices(std::vector<size_t>& indices, F remove) {
+		std::sort(indices.begin(), indices.end(), std::greater<size_t>());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+		for (size_t i : indices) {
+			remove(i);
+		}
+	}
+
+	static AABB SweptBounds(Object* obj, const glm::vec3& displacement) {
+		AABB box = obj->Bounds();
+		box.Grow(AABB(box.min - displacement, box.max - displacement));
+		return box;
+	}
+
+	static void AddIfTouching(Object* obj, const glm::vec3& center, GLfloat radius, std::vector<Object*>& result) {
+		if (!obj->SphereShape() || glm::length(obj->Position() - center) < radius + obj->Box()) {
+			result.push_back(obj);
+		}
+	}
+
+	const StaticIndex<size_t>& Statics() {
+		if (static_dirty_) {
+			std::vector<AABB> boxes;
+			std::vector<size_t> indices;
+			for (size_t i = 0; i < static_objects.size(); ++i) {
+				boxes.push_back(static_objects[i]->Bounds());
+				indices.push_back(i);
+			}
+			static_index_.Build(boxes, indices);
+			static_dirty_ = false;
+		}
+		return static_index_;
+	}
+
+	DynamicAABBTree<size_t> tree_;
+	StaticIndex<size_t> static_index_;
+	bool static_dirty_ = true;
+	uint64_t static_version_ = 0;
+	const FlowField* flow_ = nullptr;
+	HandleTable handles_;
+
+	// Kept between Apply calls so they are not allocated every tick.
+	std::vector<Command> commands_;
+	std::vector<size_t> removed_;
+	std::vector<size_t> static_removed_;
 };
 
 class Floor : public Object {
 public:
 	explicit Floor(const glm::vec3& position, int repeats=10)
-		: Object(position, glm::vec3(0.0f, 1.0f, 0.0f), 100.0f, 0.0f, "floor.obj", "new_floor.DDS") {
+		: Object(ObjectType::Floor, position, glm::vec3(0.0f, 1.0f, 0.0f), 100.0f, 0.0f, "floor.obj", "new_floor.DDS") {
 
-		size_t num = vertices_.size();
+		// The tiled copy is this floor's own mesh, the shared one stays a single tile.
+		std::shared_ptr<Mesh> tiled = std::make_shared<Mesh>(*mesh_);
+
+		size_t num = tiled->vertices.size();
 		for (int i = -repeats; i <= repeats; ++i) {
 			for (int j = -repeats; j <= repeats; ++j) {
 				for (size_t k = 0; k < num; ++k) {
-					vertices_.push_back(vertices_[k] + glm::vec3(i, 0.0f, j) * 2.0f);
+					tiled->vertices.push_back(tiled->vertices[k] + glm::vec3(i, 0.0f, j) * 2.0f);
 				}
 			}
 		}
 
-		num = uvs_.size();
+		num = tiled->uvs.size();
 		for (int i = -repeats; i <= repeats; ++i) {
 			for (int j = -repeats; j <= repeats; ++j) {
 				for (size_t k = 0; k < num; ++k) {
-					uvs_.push_back(uvs_[k]);
+					tiled->uvs.push_back(tiled->uvs[k]);
 				}
 			}
 		}
 
-		num = normals_.size();
+		num = tiled->normals.size();
 		for (int i = -repeats; i <= repeats; ++i) {
 			for (int j = -repeats; j <= repeats; ++j) {
 				for (size_t k = 0; k < num; ++k) {
-					normals_.push_back(normals_[k]);
+					tiled->normals.push_back(tiled->normals[k]);
 				}
 			}
 		}
+
+		for (const glm::vec3& vertex : tiled->vertices) {
+			model_bounds_.Grow(vertex);
+		}
+
+		pending_bvh_ = TriangleBVH::BuildAsync(tiled->vertices);
+		mesh_ = tiled;
 	}
 
 	~Floor() override = default;
-	virtual bool Interract(Object* obj, const glm::vec3& old_position) { return true; }
 	virtual bool CheckInterraction(Object* obj) {
-		glm::vec3 diff = obj->Position() - position_;
+		return Floor::OverlapSphere(obj->Position(), obj->Box());
+	}
+	bool OverlapSphere(const glm::vec3& center, GLfloat radius) override {
+		const TriangleBVH* bvh = Bvh();
+		if (bvh == nullptr) {
+			glm::vec3 diff = center - position_;
 
-		return diff.y < obj->Box();
+			return diff.y < radius;
+		}
+
+		GLfloat scale = ModelScale();
+		return bvh->OverlapSphere((center - position_) / scale, radius / scale);
 	}
-	Object* Act(const std::vector<Object*>& objects) override {
-		return nullptr;
-	};
+	bool SphereShape() override { return false; }
+	bool Static() override { return true; }
+	// Casts the center of obj along its move, exact for head-on hits which is what tunnels.
+	bool Sweep(Object* obj, const glm::vec3& old_position, const glm::vec3& obj_old_position, GLfloat& toi) override {
+		glm::vec3 move = obj->Position() - obj_old_position;
+		GLfloat distance = glm::length(move);
+		if (distance < obj->Box()) {
+			return false;
+		}
+
+		RayHit hit;
+		if (!Raycast(obj_old_position, move / distance, distance + obj->Box(), hit) || hit.distance <= obj->Box()) {
+			return false;
+		}
+
+		toi = (hit.distance - obj->Box() * (1.0f - ccd_penetration)) / distance;
+		return toi < 1.0f;
+	}
+	AABB Bounds() override {
+		GLfloat scale = ModelScale();
+		return AABB(position_ + model_bounds_.min * scale, position_ + model_bounds_.max * scale);
+	}
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, GLfloat max_distance, RayHit& hit) override {
+		const TriangleBVH* bvh = Bvh();
+		if (bvh == nullptr) {
+			return false;
+		}
+
+		GLfloat scale = ModelScale();
+		if (!bvh->Raycast((origin - position_) / scale, direction, max_distance / scale, hit)) {
+			return false;
+		}
+		hit.distance *= scale;
+		hit.point = position_ + hit.point * scale;
+		return true;
+	}
+	void Act(World& world, CommandWriter& commands) override {}
+
+	// Blocks until the BVH is built, so the plane test is never used in its place. Sessions
+	// that must replay the same can't let the worker thread decide when collisions get exact.
+	void AwaitBvh() {
+		std::lock_guard<std::mutex> lock(bvh_mutex_);
+		if (pending_bvh_.valid()) {
+			pending_bvh_.wait();
+		}
+	}
+
+private:
+	// The BVH is built in model space, main draws the mesh scaled by box / 1.5.
+	GLfloat ModelScale() {
+		return box_ / 1.5f;
+	}
+
+	// Null until the worker thread finishes, callers fall back to the plane test meanwhile.
+	// Pair tests run in parallel, so taking the result over is done under a lock.
+	const TriangleBVH* Bvh() {
+		if (!bvh_ready_.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(bvh_mutex_);
+			if (!bvh_ready_.load(std::memory_order_relaxed)) {
+				if (pending_bvh_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+					return nullptr;
+				}
+				bvh_ = pending_bvh_.get();
+				bvh_ready_.store(true, std::memory_order_release);
+			}
+		}
+		return bvh_.Empty() ? nullptr : &bvh_;
+	}
+
+	AABB model_bounds_;
+	std::future<TriangleBVH> pending_bvh_;
+	TriangleBVH bvh_;
+	std::atomic<bool> bvh_ready_{ false };
+	std::mutex bvh_mutex_;
 };
 
 class Skybox : public Object {
 public:
 	explicit Skybox(const glm::vec3& position)
-		: Object(position, glm::vec3(0.0f, 1.0f, 0.0f), max_distance, 0.0f, "skybox.obj", "skybox.DDS") {}
+		: Object(ObjectType::Skybox, position, glm::vec3(0.0f, 1.0f, 0.0f), max_distance, 0.0f, "skybox.obj", "skybox.DDS") {}
 
 	void Save(std::iostream& file) override {
 		Object::Save(file);
@@ -229,25 +1036,19 @@ public:
 	}
 
 	~Skybox() override = default;
-	virtual bool Interract(Object* obj, const glm::vec3& old_position) { return true; }
 	virtual bool CheckInterraction(Object* obj) {
 		glm::vec3 diff = obj->Position() - position_;
 
 		return glm::length(diff) > box_ - obj->Box();
 	}
-	Object* Act(const std::vector<Object*>& objects) override {
-		return nullptr;
-	};
-	void MoveTo(const glm::vec3& position) {
-		position_ = position;
-	}
+	void Act(World& world, CommandWriter& commands) override {}
 };
 
 class Actor : public Object {
 public:
-	explicit Actor(const glm::vec3& position, GLfloat box, GLfloat hp, GLfloat speed, 
+	explicit Actor(ObjectType type, const glm::vec3& position, GLfloat box, GLfloat hp, GLfloat speed, 
 		const glm::vec3& direction)
-		: Object(position, direction, box, speed, "enemy.obj", "enemy.DDS"), hp_(hp) {}
+		: Object(type, position, direction, box, speed, "enemy.obj", "enemy.DDS"), hp_(hp) {}
 
 	void Save(std::iostream& file) override {
 		Object::Save(file);
@@ -259,32 +1060,55 @@ public:
 		file >> hp_;
 	}
 
-	~Actor() override = default;
-	bool Interract(Object* obj, const glm::vec3& old_position) override;
-	void ReceiveDamage(GLfloat damage) { this->hp_ -= damage; };
-	void Die() { this->hp_ = -1.0f; };
-	float HP() { return hp_; }
-	Object* Act(const std::vector<Object*>& objects) override { return nullptr; }
+	void Write(ObjectRecord& record) override {
+		Object::Write(record);
+		record.hp = hp_;
+	}
 
-protected:
-	GLfloat hp_;
+	void Read(const ObjectRecord& record) override {
+		Object::Read(record);
+		hp_ = record.hp;
+	}
+
+	~Actor() override = default;
+	template <ObjectType Other>
+	bool InterractWith(Object* obj, Contact& contact);
+	// False if the actor died.
+	bool Resolve(const Contact& contact, const glm::vec3& old_position) {
+		ReceiveDamage(contact.damage);
+		if (contact.blocked) {
+			position_ = old_position;
+		}
+		return hp_ > 0.0f;
+	}
+	void ReceiveDamage(GLfloat damage) { this->hp_ -= damage; };
+	void Die() { this->hp_ = -1.0f; };
+	float HP() { return hp_; }
+	void Act(World& world, CommandWriter& commands) override {}
+	// The weapon cooldown ran out.
+	void OnTimer(GLfloat now) override { ready_ = true; }
+
+protected:
+	GLfloat hp_;
+	bool ready_ = false;
 };
 
-class Dummy : public Actor {
+class Dummy : public Actor, public Pooled<Dummy> {
 public:
 	explicit Dummy(const glm::vec3& position, const glm::vec3& direction = glm::vec3(0.0f, 0.0f, 0.0f),
 		GLfloat box = 1.0f, GLfloat hp = 1.0f)
-		: Actor(position, box, hp, 0.0f, direction) {}
+		: Actor(ObjectType::Dummy, position, box, hp, 0.0f, direction) {}
 	~Dummy() override = default;
+	bool Static() override { return true; }
 };
 
-class Projectile : public Object {
+class Projectile : public Object, public Pooled<Projectile> {
 public:
 	explicit Projectile(const glm::vec3& position, const glm::vec3& direction, GLfloat box = 0.1f,
 		GLfloat damage = 1.0f, GLfloat speed = 10.0f, GLfloat tl = 10.0f, GLfloat explode_speed = 10.0f,
 		GLfloat explode_duration = 1.0f)
-		: Object(position, direction, box, speed, "projectile.obj", "projectile.DDS"), 
-		damage_(damage), end_time_(glfwGetTime() + tl), explode_speed_(explode_speed),
+		: Object(ObjectType::Projectile, position, direction, box, speed, "projectile.obj", "projectile.DDS"), 
+		damage_(damage), end_time_(GameTime() + tl), explode_speed_(explode_speed),
 		explode_duration_(explode_duration) {}
 
 	void Save(std::iostream& file) override {
@@ -299,94 +1123,237 @@ public:
 			time_exploded_ >> explode_speed_ >> explode_duration_;
 	}
 
+	void Write(ObjectRecord& record) override {
+		Object::Write(record);
+		record.flags = (exploded_ ? 1u : 0u) | (interracted_ ? 2u : 0u);
+		record.values[0] = damage_;
+		record.values[1] = end_time_;
+		record.values[2] = time_exploded_;
+		record.values[3] = explode_speed_;
+		record.values[4] = explode_duration_;
+	}
+
+	void Read(const ObjectRecord& record) override {
+		Object::Read(record);
+		exploded_ = (record.flags & 1u) != 0;
+		interracted_ = (record.flags & 2u) != 0;
+		damage_ = record.values[0];
+		end_time_ = record.values[1];
+		time_exploded_ = record.values[2];
+		explode_speed_ = record.values[3];
+		explode_duration_ = record.values[4];
+	}
+
 	~Projectile() override = default;
-	bool Interract(Object* obj, const glm::vec3& old_position) override;
+	template <ObjectType Other>
+	bool InterractWith(Object* obj, Contact& contact);
+	bool Resolve(const Contact& contact) {
+		interracted_ = true;
+		ScheduleTimer(this, Deadline());
+		return true;
+	}
 	GLfloat DealDamage(Object* obj) { return damage_; };
-	bool CheckSelf() override { 
+	// Time of the next state change: the end of the flight (right away once something was hit)
+	// or the end of the explosion.
+	GLfloat Deadline() override {
+		if (exploded_) {
+			return time_exploded_ + explode_duration_;
+		}
+		return interracted_ ? -FLT_MAX : end_time_;
+	}
+	// The flight ends in an explosion, the explosion with the projectile gone.
+	void OnTimer(GLfloat now) override {
 		if (!exploded_) {
-			if ((glfwGetTime() > end_time_) || interracted_) {
-				Explode();
-			}
-			return true;
-		} else {
-			return glfwGetTime() - time_exploded_ < explode_duration_;
+			Explode(now);
+			ScheduleTimer(this, Deadline());
+		}
+		else {
+			gone_ = true;
 		}
 	}
-	Object* Act(const std::vector<Object*>& objects) {
-		return nullptr; 
+	bool CheckSelf() override {
+		return !gone_;
 	}
+	void Act(World& world, CommandWriter& commands) override {}
 	GLfloat ExplodedMove() {
 		if (exploded_) {
-			return (glfwGetTime() - time_exploded_) * explode_speed_;
+			return (GameTime() - time_exploded_) * explode_speed_;
 		}
 		else {
 			return 0.0f;
 		}
 	}
-	void Explode() {
+	void Explode(GLfloat now) {
 		exploded_ = true;
 		direction_ = glm::vec3();
-		time_exploded_ = glfwGetTime();
+		time_exploded_ = now;
 	}
 	bool Exploded() {
 		return exploded_;
 	}
+	void MarkInterracted() {
+		interracted_ = true;
+	}
 
 protected:
 	GLfloat damage_;
 	GLfloat end_time_;
 	bool exploded_ = false;
 	bool interracted_ = false;
+	bool gone_ = false;
 	GLfloat time_exploded_ = 0.0f;
 	GLfloat explode_speed_;
 	GLfloat explode_duration_;
 };
 
-bool Actor::Interract(Object* obj, const glm::vec3& old_position) {
-	if (CheckInterraction(obj) && obj->CheckInterraction(this)) {
-		Projectile* proj = dynamic_cast<Projectile*>(obj);
-		if (proj != nullptr) {
-			if (!proj->Exploded()) {
-				ReceiveDamage(proj->DealDamage(this));
-			}
-		}
-		if (dynamic_cast<Actor*>(obj) != nullptr) {
-			position_ = old_position;
-		}
-		if (dynamic_cast<Floor*>(obj) != nullptr) {
-			position_ = old_position;
-		}
-		return hp_ > 0.0f;
+// obj->CheckInterraction(other) for an obj known to be of type T, without the virtual call.
+template <ObjectType T>
+bool TypedCheckInterraction(Object* obj, Object* other) {
+	if constexpr (T == ObjectType::Floor) {
+		return static_cast<Floor*>(obj)->Floor::CheckInterraction(other);
+	}
+	else if constexpr (T == ObjectType::Skybox) {
+		return static_cast<Skybox*>(obj)->Skybox::CheckInterraction(other);
 	}
 	else {
-		return true;
+		return obj->Object::CheckInterraction(other);
 	}
 }
 
-bool Projectile::Interract(Object* obj, const glm::vec3& old_position) {
-	if (!exploded_) {
-		if (dynamic_cast<Floor*>(obj) != nullptr) {
-			if (obj->CheckInterraction(this)) {
-				interracted_ = true;
-			}
-		}
-		else {
-			if (CheckInterraction(obj) && obj->CheckInterraction(this)) {
-				if (dynamic_cast<Actor*>(obj) != nullptr) {
-					interracted_ = true;
-				}
-			}
+template <ObjectType Other>
+bool Actor::InterractWith(Object* obj, Contact& contact) {
+	if (!Object::CheckInterraction(obj) || !TypedCheckInterraction<Other>(obj, this)) {
+		return false;
+	}
+	contact.damage = 0.0f;
+	if constexpr (Other == ObjectType::Projectile) {
+		Projectile* proj = static_cast<Projectile*>(obj);
+		if (!proj->Exploded()) {
+			contact.damage = proj->DealDamage(this);
 		}
 	}
+	contact.blocked = IsActor(Other) || Other == ObjectType::Floor;
+	return true;
+}
+
+template <ObjectType Other>
+bool Projectile::InterractWith(Object* obj, Contact& contact) {
+	if (exploded_) {
+		return false;
+	}
+	contact.damage = 0.0f;
+	contact.blocked = false;
+	if constexpr (Other == ObjectType::Floor) {
+		return TypedCheckInterraction<Other>(obj, this);
+	}
+	else if constexpr (IsActor(Other)) {
+		return Object::CheckInterraction(obj) && TypedCheckInterraction<Other>(obj, this);
+	}
+	else {
+		return false;
+	}
+}
+
+// Fills in the effect of other on obj, false if there is none. Changes nothing.
+typedef bool (*InterractFunction)(Object* obj, Object* other, Contact& contact);
+
+template <ObjectType Type, ObjectType Other>
+bool TypedInterract(Object* obj, Object* other, Contact& contact) {
+	if constexpr (IsActor(Type)) {
+		return static_cast<Actor*>(obj)->InterractWith<Other>(other, contact);
+	}
+	else if constexpr (Type == ObjectType::Projectile) {
+		return static_cast<Projectile*>(obj)->InterractWith<Other>(other, contact);
+	}
+	else {
+		return false;
+	}
+}
+
+template <size_t... Pairs>
+constexpr std::array<InterractFunction, sizeof...(Pairs)> MakeInterractTable(std::index_sequence<Pairs...>) {
+	return { { &TypedInterract<ObjectType(Pairs / object_type_count), ObjectType(Pairs % object_type_count)>... } };
+}
+
+// Handler of every (type, other type) combination, generated at compile time.
+static constexpr std::array<InterractFunction, object_type_count * object_type_count> interract_table =
+	MakeInterractTable(std::make_index_sequence<object_type_count * object_type_count>());
+
+inline bool Interract(Object* obj, Object* other, Contact& contact) {
+	return interract_table[size_t(obj->Type()) * object_type_count + size_t(other->Type())](obj, other, contact);
+}
+
+// Whether the handler of (type, other) can find a contact at all, as TypedInterract decides.
+constexpr bool Interracts(ObjectType type, ObjectType other) {
+	return IsActor(type) || (type == ObjectType::Projectile && (other == ObjectType::Floor || IsActor(other)));
+}
+
+template <size_t... Pairs>
+constexpr std::array<bool, sizeof...(Pairs)> MakeCollidesTable(std::index_sequence<Pairs...>) {
+	return { { (Interracts(ObjectType(Pairs / object_type_count), ObjectType(Pairs % object_type_count)) ||
+		Interracts(ObjectType(Pairs % object_type_count), ObjectType(Pairs / object_type_count)))... } };
+}
+
+// Pairs of types with a contact in either direction, the only ones sweeps stop movers at.
+static constexpr std::array<bool, object_type_count * object_type_count> collides_table =
+	MakeCollidesTable(std::make_index_sequence<object_type_count * object_type_count>());
+
+inline bool Collides(Object* obj, Object* other) {
+	return collides_table[size_t(obj->Type()) * object_type_count + size_t(other->Type())];
+}
+
+// Applies a contact found by Interract to obj, false if obj has to be removed.
+inline bool Resolve(Object* obj, const Contact& contact, const glm::vec3& old_position) {
+	if (IsActor(obj->Type())) {
+		return static_cast<Actor*>(obj)->Resolve(contact, old_position);
+	}
+	if (obj->Type() == ObjectType::Projectile) {
+		return static_cast<Projectile*>(obj)->Resolve(contact);
+	}
 	return true;
 }
 
+// Buttons of an InputFrame and the keys they are held with.
+static const uint32_t button_forward = 1u << 0;
+static const uint32_t button_back = 1u << 1;
+static const uint32_t button_right = 1u << 2;
+static const uint32_t button_left = 1u << 3;
+static const uint32_t button_fire = 1u << 4;
+static const uint32_t button_blast = 1u << 5;
+static const uint32_t button_save = 1u << 6;
+static const uint32_t button_load = 1u << 7;
+static const uint32_t button_export = 1u << 8;
+static const uint32_t button_rewind = 1u << 9;
+
+static const std::pair<int, uint32_t> key_buttons[] = {
+	{ GLFW_KEY_W, button_forward }, { GLFW_KEY_S, button_back }, { GLFW_KEY_D, button_right }, { GLFW_KEY_A, button_left },
+	{ GLFW_KEY_Q, button_fire }, { GLFW_KEY_E, button_blast }, { GLFW_KEY_Z, button_save }, { GLFW_KEY_X, button_load },
+	{ GLFW_KEY_C, button_export }, { GLFW_KEY_R, button_rewind }
+};
+
+// Input of the tick about to run. The cursor goes back to the window center, the next
+// tick measures its move from there.
+InputFrame SampleInput() {
+	InputFrame input;
+	for (const std::pair<int, uint32_t>& key : key_buttons) {
+		if (glfwGetKey(window, key.first) == GLFW_PRESS) {
+			input.buttons |= key.second;
+		}
+	}
+	double xpos, ypos;
+	glfwGetCursorPos(window, &xpos, &ypos);
+	glfwSetCursorPos(window, w / 2, h / 2);
+	input.look_x = GLfloat(w / 2 - xpos);
+	input.look_y = GLfloat(h / 2 - ypos);
+	return input;
+}
+
 class Player : public Actor, public Camera {
 public:
 	explicit Player(const glm::vec3& position = glm::vec3(0.0f, 2.0f, 0.0f), 
 		GLfloat box = 1.0f, GLfloat hp = 10.0f, GLfloat speed=5.0f, GLfloat mouse_speed = 0.005f,
 		GLfloat cooldown = 1.0f, size_t killed = 0)
-		: Actor(position, box, hp, speed, glm::vec3(0.0f, 0.0f, 0.0f)), 
+		: Actor(ObjectType::Player, position, box, hp, speed, glm::vec3(0.0f, 0.0f, 0.0f)), 
 		mouse_speed_(mouse_speed), cooldown_(cooldown), killed_(killed) {}
 
 	~Player() override = default;
@@ -403,12 +1370,32 @@ public:
 		file >> killed_ >> mouse_speed_ >> cooldown_ >> next_projectile_;
 	}
 
-	Object* Act(const std::vector<Object*>& objects) override {
-		double xpos, ypos;
-		glfwGetCursorPos(window, &xpos, &ypos);
-		glfwSetCursorPos(window, w / 2, h / 2);
-		horizontal_angle_ += mouse_speed_ * GLfloat(w / 2 - xpos);
-		vertical_angle_ += mouse_speed_ * GLfloat(h / 2 - ypos);
+	void Write(ObjectRecord& record) override {
+		Actor::Write(record);
+		Camera::Write(record);
+		record.count = uint32_t(killed_);
+		record.values[3] = mouse_speed_;
+		record.values[4] = cooldown_;
+		record.values[5] = next_projectile_;
+	}
+
+	void Read(const ObjectRecord& record) override {
+		Actor::Read(record);
+		Camera::Read(record);
+		killed_ = record.count;
+		mouse_speed_ = record.values[3];
+		cooldown_ = record.values[4];
+		next_projectile_ = record.values[5];
+	}
+
+	// Input the next Act goes by, sampled or played back by main.
+	void SetInput(const InputFrame& input) {
+		input_ = input;
+	}
+
+	void Act(World& world, CommandWriter& commands) override {
+		horizontal_angle_ += mouse_speed_ * input_.look_x;
+		vertical_angle_ += mouse_speed_ * input_.look_y;
 
 		if (vertical_angle_ > 3.14f / 2.0f) {
 			vertical_angle_ = 3.14f / 2.0f;
@@ -428,16 +1415,16 @@ public:
 
 		glm::vec3 final_direction = glm::vec3(0.0f, 0.0f, 0.0f);
 
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+		if (input_.Held(button_forward)) {
 			final_direction += direction;
 		}
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+		if (input_.Held(button_back)) {
 			final_direction -= direction;
 		}
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+		if (input_.Held(button_right)) {
 			final_direction += right;
 		}
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+		if (input_.Held(button_left)) {
 			final_direction -= right;
 		}
 
@@ -449,24 +1436,24 @@ public:
 
 		glm::vec3 camera_direction = CameraDirection();
 
-		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-			if (glfwGetTime() > next_projectile_) {
-				next_projectile_ = glfwGetTime() + cooldown_;
-				Projectile* new_proj = new Projectile(position_ + camera_direction * (box_ + 0.2f), 
-					camera_direction, 0.1f, 1.0f);
-				return new_proj;
+		if (input_.Held(button_fire)) {
+			if (ready_) {
+				Reload();
+				commands.Spawn(new Projectile(position_ + camera_direction * (box_ + 0.2f), 
+					camera_direction, 0.1f, 1.0f));
 			}
 		}
-		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-			if (glfwGetTime() > next_projectile_) {
-				next_projectile_ = glfwGetTime() + cooldown_;
-				Projectile* new_proj = new Projectile(position_ + camera_direction * (box_ + 2.0f), 
-					camera_direction, 1.0f, 2.0f, 1.0f, 20.0f);
-				return new_proj;
+		if (input_.Held(button_blast)) {
+			if (ready_) {
+				Reload();
+				commands.Spawn(new Projectile(position_ + camera_direction * (box_ + 2.0f), 
+					camera_direction, 1.0f, 2.0f, 1.0f, 20.0f));
 			}
 		}
-		
-		return nullptr;
+	}
+
+	GLfloat Deadline() override {
+		return next_projectile_;
 	}
 
 	size_t Killed() {
@@ -478,17 +1465,24 @@ public:
 	}
 
 protected:
+	void Reload() {
+		ready_ = false;
+		next_projectile_ = GameTime() + cooldown_;
+		ScheduleTimer(this, next_projectile_);
+	}
+
 	size_t killed_;
 	GLfloat mouse_speed_;
 	GLfloat cooldown_;
-	GLfloat next_projectile_ = glfwGetTime();
+	GLfloat next_projectile_ = GameTime();
+	InputFrame input_;
 };
 
-class Enemy : public Actor {
+class Enemy : public Actor, public Pooled<Enemy> {
 public:
 	explicit Enemy(const glm::vec3& position, const glm::vec3& direction = glm::vec3(0.0f, 0.0f, 0.0f), 
 		GLfloat box = 1.0f, GLfloat hp = 1.0f, GLfloat speed = 1.0f, GLfloat cooldown = 5.0f)
-		: Actor(position, box, hp, speed, direction), cooldown_(cooldown) {}
+		: Actor(ObjectType::Enemy, position, box, hp, speed, direction), cooldown_(cooldown), heading_(direction) {}
 
 	~Enemy() override = default;
 
@@ -500,141 +1494,306 @@ public:
 	void Load(std::iostream& file) override {
 		Actor::Load(file);
 		file >> cooldown_ >> next_projectile_;
+		heading_ = direction_;
 	}
 
-	Object* Act(const std::vector<Object*>& objects) override {
-		Object* target = nullptr;
+	void Write(ObjectRecord& record) override {
+		Actor::Write(record);
+		record.values[0] = cooldown_;
+		record.values[1] = next_projectile_;
+	}
 
-		for (Object* obj : objects) {
-			Player* cast_obj = dynamic_cast<Player*>(obj);
-			if (cast_obj != nullptr) {
-				target = cast_obj;
-				break;
-			}
+	void Read(const ObjectRecord& record) override {
+		Actor::Read(record);
+		cooldown_ = record.values[0];
+		next_projectile_ = record.values[1];
+		heading_ = direction_;
+	}
+
+	// Thinking is the behaviour running on to its next yield. The world and the command
+	// writer of this think are only valid while it runs.
+	void Act(World& world, CommandWriter& commands) override {
+		think_pending_ = false;
+		if (!behaviour_.Running()) {
+			behaviour_ = Hunt();
 		}
+		world_ = &world;
+		commands_ = &commands;
+		behaviour_.Resume();
+		world_ = nullptr;
+		commands_ = nullptr;
+	}
 
-		if (target != nullptr) {
-			glm::vec3 direction = target->Position() - position_;
-			if (glm::length(direction) > 0.0f) {
-				direction /= glm::length(direction);
-			}
+	GLfloat Deadline() override {
+		return next_projectile_;
+	}
+
+	// Bends the way Act chose away from the neighbours, every tick whether it thought or not.
+	void Steer(const glm::vec3& push) {
+		glm::vec3 direction = heading_ + push * separation_weight;
+		GLfloat length = glm::length(direction);
+		direction_ = length > 0.0f ? direction / length : heading_;
+	}
 
-			direction_ = direction;
+	// Set while an update was due but left out by the AI budget.
+	bool ThinkPending() { return think_pending_; }
+	void SetThinkPending() { think_pending_ = true; }
 
-			if (glfwGetTime() > next_projectile_) {
-				next_projectile_ = glfwGetTime() + cooldown_;
-				Projectile* new_proj = new Projectile(position_ + direction * (box_ + 0.2f),
-					direction, 0.1f, 2.0f);
-				return new_proj;
+protected:
+	// Walks the flow field toward the nearest player. Once reloaded it checks on the next
+	// think whether a static collider hides the target and fires if not, so the sight line
+	// never shares a think with the search. The target is kept by handle across thinks.
+	Behaviour Hunt() {
+		for (;;) {
+			Object* target = FindTarget();
+			if (target != nullptr) {
+				Walk(target);
+				if (ready_) {
+					co_await Behaviour::Next();
+					target = world_->Find(target_);
+					if (target != nullptr) {
+						Walk(target);
+						if (InSight(target)) {
+							Fire(target);
+						}
+					}
+				}
 			}
+			co_await Behaviour::Next();
 		}
-
-		return nullptr;
 	}
 
-protected:
-	GLfloat cooldown_;
-	GLfloat next_projectile_ = glfwGetTime() + cooldown_;
-};
+	Object* FindTarget() {
+		std::vector<Object*> nearest = world_->QueryKNearest(position_, 1, [](Object* obj) {
+			return obj->Type() == ObjectType::Player;
+		});
+		if (nearest.empty()) {
+			return nullptr;
+		}
+		target_ = nearest[0]->GetHandle();
+		return nearest[0];
+	}
 
-class EnemyCreator {
-public:
-	explicit EnemyCreator(GLfloat cooldown = 10.0f, size_t retries = 10, GLfloat p = 0.01, GLfloat r_from = 30.0f,
-		GLfloat r_to = 50.0f, GLfloat hp_from = 1.0f, GLfloat hp_to = 5.0f, 
-		GLfloat speed_from = 1.0f, GLfloat speed_to = 2.0f)
-		: cooldown_(cooldown), rng_(std::random_device()()), retries_(retries), type_(p), angle_(-3.14, 3.14),
-		r_(r_from, r_to), hp_(hp_from, hp_to), speed_(speed_from, speed_to)
-	{}
+	glm::vec3 Aim(Object* target) {
+		glm::vec3 direction = target->Position() - position_;
+		if (glm::length(direction) > 0.0f) {
+			direction /= glm::length(direction);
+		}
+		return direction;
+	}
 
-	Object* CreateEnemy(const glm::vec3& position, const std::vector<Object*>& objects) {
-		if (glfwGetTime() > next_creation_) {
-			next_creation_ = glfwGetTime() + cooldown_;
+	// Walk the flow field round static colliders, straight at the target without one.
+	void Walk(Object* target) {
+		glm::vec3 way;
+		const FlowField* flow = world_->Flow();
+		heading_ = flow != nullptr && flow->Sample(position_, way) ? way : Aim(target);
+		direction_ = heading_;
+	}
 
-			GLfloat angle_direction = angle_(rng_);
-			glm::vec3 orientation(
-				sin(angle_direction),
-				0.0f,
-				cos(angle_direction)
-			);
+	bool InSight(Object* target) {
+		glm::vec3 offset = target->Position() - position_;
+		GLfloat distance = glm::length(offset);
+		GLfloat start = box_ + 0.2f;
+		if (distance <= start) {
+			return true;
+		}
+		RayHit hit;
+		return world_->RaycastStatic(position_ + offset / distance * start, offset / distance, distance - start, hit) == nullptr;
+	}
 
-			bool type = type_(rng_);
+	void Fire(Object* target) {
+		glm::vec3 direction = Aim(target);
+		Reload();
+		commands_->Spawn(new Projectile(position_ + direction * (box_ + 0.2f),
+			direction, 0.1f, 2.0f));
+	}
 
-			for (size_t retry = 0; retry < retries_; ++retry) {
-				GLfloat angle_position = angle_(rng_);
-				glm::vec3 direction(
-					sin(angle_position),
-					0.0f,
-					cos(angle_position)
-				);
+	void Reload() {
+		ready_ = false;
+		next_projectile_ = GameTime() + cooldown_;
+		ScheduleTimer(this, next_projectile_);
+	}
 
-				GLfloat r = r_(rng_);
+	bool think_pending_ = false;
+	GLfloat cooldown_;
+	// Way to the target from the last think, before steering.
+	glm::vec3 heading_;
+	GLfloat next_projectile_ = GameTime() + cooldown_;
+	Handle target_;
+	Behaviour behaviour_;
+	World* world_ = nullptr;
+	CommandWriter* commands_ = nullptr;
+};
 
-				glm::vec3 new_position = position + r * direction;
+class EnemyCreator : public Timed {
+public:
+	explicit EnemyCreator(uint32_t seed, GLfloat cooldown = 10.0f, size_t retries = 10, GLfloat p = 0.01, GLfloat r_from = 30.0f,
+		GLfloat r_to = 50.0f, GLfloat hp_from = 1.0f, GLfloat hp_to = 5.0f, 
+		GLfloat speed_from = 1.0f, GLfloat speed_to = 2.0f)
+		: cooldown_(cooldown), rng_(seed), retries_(retries), type_(p), angle_(-3.14, 3.14),
+		r_from_(r_from), r_to_(r_to), hp_(hp_from, hp_to), speed_(speed_from, speed_to)
+	{
+		ScheduleTimer(this, next_creation_);
+	}
 
-				Object* new_obj = nullptr;
+	void OnTimer(GLfloat now) override {
+		due_ = true;
+	}
 
-				if (type) {
-					new_obj = new Enemy(new_position, orientation, 1.0f, hp_(rng_), speed_(rng_));
+	// Spawns what the director asks for: the waves of its script, or one object at the pace set
+	// on construction scaled by the load it measured, more of them enemies the lighter the load.
+	void CreateEnemy(const glm::vec3& position, World& world, SpawnDirector& director, CommandWriter& commands) {
+		if (due_) {
+			due_ = false;
+			placed_.clear();
+			if (director.Scripted()) {
+				SpawnWave wave;
+				while (director.TakeWave(GameTime(), wave)) {
+					for (int i = 0; i < wave.count; ++i) {
+						Place(position, world, commands, std::bernoulli_distribution(wave.enemy_share)(rng_));
+					}
 				}
-				else {
-					new_obj = new Dummy(new_position, orientation, 1.0f, hp_(rng_));
+				next_creation_ = GLfloat(director.NextWave());
+			}
+			else {
+				next_creation_ = GameTime() + cooldown_ / director.Rate();
+				if (director.AllowSpawn()) {
+					Place(position, world, commands, std::bernoulli_distribution(std::min(1.0, type_.p() * director.Rate()))(rng_));
 				}
+			}
+			ScheduleTimer(this, next_creation_);
+		}
+	}
+private:
+	// Spots are tried on position and radius alone, an object is only made for one that is free.
+	// The world doesn't hold this tick's spawns yet, so they are kept apart through placed_.
+	void Place(const glm::vec3& position, World& world, CommandWriter& commands, bool enemy) {
+		GLfloat angle_direction = angle_(rng_);
+		glm::vec3 orientation(
+			sin(angle_direction),
+			0.0f,
+			cos(angle_direction)
+		);
 
-				bool possible = true;
-
-				for (Object* obj : objects) {
-					possible = possible && (!new_obj->CheckInterraction(obj) || !obj->CheckInterraction(new_obj));
-				}
+		for (size_t retry = 0; retry < retries_; ++retry) {
+			glm::vec3 new_position = position + NextSpot();
 
-				if (possible) {
-					return new_obj;
+			if (world.SpotFree(new_position, spawn_radius) && !NearPlaced(new_position)) {
+				placed_.push_back(new_position);
+				if (enemy) {
+					commands.Spawn(new Enemy(new_position, orientation, spawn_radius, hp_(rng_), speed_(rng_)));
 				}
 				else {
-					delete new_obj;
+					commands.Spawn(new Dummy(new_position, orientation, spawn_radius, hp_(rng_)));
 				}
+				return;
 			}
 		}
-		return nullptr;
 	}
-private:
+
+	bool NearPlaced(const glm::vec3& spot) const {
+		for (const glm::vec3& placed : placed_) {
+			glm::vec3 diff = placed - spot;
+			if (glm::dot(diff, diff) < 4.0f * spawn_radius * spawn_radius) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Next offset from a shuffled Poisson disk set over the spawn ring, a new set once it is used up.
+	glm::vec3 NextSpot() {
+		if (next_spot_ >= spots_.size()) {
+			spots_ = PoissonDiskRing(r_from_, r_to_, spawn_spacing, rng_);
+			next_spot_ = 0;
+			if (spots_.empty()) {
+				return glm::vec3(0.0f, 0.0f, r_from_);
+			}
+		}
+		return spots_[next_spot_++];
+	}
+
 	GLfloat cooldown_;
 	size_t retries_;
-	GLfloat next_creation_ = glfwGetTime();
+	GLfloat next_creation_ = GameTime();
+	bool due_ = false;
 	std::mt19937 rng_;
 	std::bernoulli_distribution type_;
 	std::uniform_real_distribution<> angle_;
-	std::uniform_real_distribution<> r_;
+	GLfloat r_from_;
+	GLfloat r_to_;
 	std::uniform_real_distribution<> hp_;
 	std::uniform_real_distribution<> speed_;
+	std::vector<glm::vec3> spots_;
+	size_t next_spot_ = 0;
+	// Spots taken by the spawns of this tick.
+	std::vector<glm::vec3> placed_;
+};
+
+// Turns the model to face the direction of the object in the horizontal plane.
+glm::mat4 ModelMatrix(Object* obj) {
+	glm::mat4 Scale = glm::scale(glm::mat4(), glm::vec3(obj->Box(), obj->Box(), obj->Box()) / 1.5f);
+	glm::mat4 Translate = glm::translate(glm::mat4(), obj->Position());
+
+	glm::vec3 direction = obj->GetDirection();
+	glm::vec3 base_direction(1.0f, 0.0f, 0.0f);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	GLfloat sin_value = glm::dot(glm::cross(base_direction, direction), up);
+	GLfloat cos_value = glm::dot(base_direction, direction);
+
+	glm::mat4 Rotate = glm::rotate(glm::mat4(), std::atan2(sin_value, cos_value), up);
+
+	return Translate * Rotate * Scale;
+}
+
+static const char* const object_type_names[object_type_count] = {
+	"Player", "Dummy", "Enemy", "Projectile", "Floor", "Skybox"
 };
 
-void SaveToFile(const std::string& file, std::vector<Object*>& objects) {
+// An empty object of a type saves hold, nullptr for any other id.
+Object* MakeObject(ObjectType type) {
+	switch (type) {
+	case ObjectType::Player:
+		return new Player();
+	case ObjectType::Dummy:
+		return new Dummy(glm::vec3());
+	case ObjectType::Enemy:
+		return new Enemy(glm::vec3());
+	case ObjectType::Projectile:
+		return new Projectile(glm::vec3(), glm::vec3());
+	case ObjectType::Floor:
+		return new Floor(glm::vec3());
+	default:
+		return nullptr;
+	}
+}
+
+// Loaded objects take the place of the world's, the player comes first.
+void ReplaceWorld(World& world, double time, const std::vector<Object*>& new_objects, Handle& player) {
+	game_time = time;
+	RebaseTimers(game_time);
+
+	world.Clear();
+	for (Object* new_obj : new_objects) {
+		world.Add(new_obj);
+	}
+	player = world.objects[0]->GetHandle();
+}
+
+// Text export, slow but readable. Saves go through SaveInBackground.
+void SaveToFile(const std::string& file, World& world) {
 	std::fstream fs;
 	fs.open(file, std::fstream::out);
-	fs << glfwGetTime() << std::endl;
-	fs << objects.size() << std::endl;
-	for (Object* obj : objects) {
-		if (dynamic_cast<Player*>(obj) != nullptr) {
-			fs << 0 << std::endl;
-		}
-		if (dynamic_cast<Dummy*>(obj) != nullptr) {
-			fs << 1 << std::endl;
-		}
-		if (dynamic_cast<Enemy*>(obj) != nullptr) {
-			fs << 2 << std::endl;
-		}
-		if (dynamic_cast<Projectile*>(obj) != nullptr) {
-			fs << 3 << std::endl;
-		}
-		if (dynamic_cast<Floor*>(obj) != nullptr) {
-			fs << 4 << std::endl;
-		}
+	fs << GameTime() << std::endl;
+	fs << world.Size() << std::endl;
+	world.ForEach([&](Object* obj) {
+		fs << size_t(obj->Type()) << std::endl;
 		obj->Save(fs);
-	}
+	});
 	fs.close();
 }
 
-void LoadFromFile(const std::string& file, std::vector<Object*>& objects, Player*& player, GLfloat& prev_time) {
+void LoadFromFile(const std::string& file, World& world, Handle& player) {
 	std::fstream fs;
 	fs.open(file, std::fstream::in);
 
@@ -651,21 +1810,14 @@ void LoadFromFile(const std::string& file, std::vector<Object*>& objects, Player
 			size_t type;
 			fs >> type;
 
-			Object* new_obj = nullptr;
-			if (type == 0) {
-				new_obj = new Player();
-			}
-			if (type == 1) {
-				new_obj = new Dummy(glm::vec3());
-			}
-			if (type == 2) {
-				new_obj = new Enemy(glm::vec3());
-			}
-			if (type == 3) {
-				new_obj = new Projectile(glm::vec3(), glm::vec3());
-			}
-			if (type == 4) {
-				new_obj = new Floor(glm::vec3());
+			// Records have no length, so one of a type we can't read loses the rest of the file.
+			Object* new_obj = type < object_type_count ? MakeObject(ObjectType(type)) : nullptr;
+			if (new_obj == nullptr) {
+				printf("Can't load %s: unknown object type %zu\n", file.c_str(), type);
+				for (Object* built : new_objects) {
+					delete built;
+				}
+				return;
 			}
 			new_obj->Load(fs);
 
@@ -673,347 +1825,1453 @@ void LoadFromFile(const std::string& file, std::vector<Object*>& objects, Player
 		}
 		fs.close();
 
-		for (Object* old_obj : objects) {
-			delete old_obj;
-		}
-
-		objects = new_objects;
-		player = dynamic_cast<Player*>(objects[0]);
-
-		glfwSetTime(time);
-		prev_time = glfwGetTime();
+		ReplaceWorld(world, time, new_objects, player);
 	}
 }
 
-int main(void)
-{
-	if (!glfwInit())
-	{
-		fprintf(stderr, "Failed to initialize GLFW\n");
-		getchar();
-		return -1;
+// The table naming the type ids records use.
+std::vector<SaveType> SaveTypes() {
+	std::vector<SaveType> types(object_type_count, SaveType());
+	for (size_t i = 0; i < object_type_count; ++i) {
+		types[i].id = uint32_t(i);
+		snprintf(types[i].name, sizeof(types[i].name), "%s", object_type_names[i]);
 	}
+	return types;
+}
 
-	glfwWindowHint(GLFW_SAMPLES, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-	window = glfwCreateWindow(w, h, "Shooter", NULL, NULL);
-	if (window == NULL) {
-		fprintf(stderr, "Failed to open GLFW window.\n");
-		getchar();
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
+// Every object as one ObjectRecord, into records kept from the last call. The records share
+// nothing with the world, so they are a snapshot the world can go on changing under.
+void CaptureRecords(World& world, std::vector<ObjectRecord>& records) {
+	records.assign(world.Size(), ObjectRecord());
+	size_t i = 0;
+	world.ForEach([&](Object* obj) {
+		obj->Write(records[i++]);
+	});
+}
 
-	glewExperimental = true;
-	if (glewInit() != GLEW_OK) {
-		fprintf(stderr, "Failed to initialize GLEW\n");
-		getchar();
-		glfwTerminate();
-		return -1;
-	}
+std::vector<ObjectRecord> CaptureRecords(World& world) {
+	std::vector<ObjectRecord> records;
+	CaptureRecords(world, records);
+	return records;
+}
 
-	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+// The world as CaptureRecords took it, for rewinds. Moving objects are all rebuilt, static
+// ones only if no record matches them byte for byte, so the floor is kept unless it changed.
+void RestoreRecords(World& world, double time, const ObjectRecord* records, size_t count, Handle& player) {
+	game_time = time;
+	RebaseTimers(game_time);
 
+	world.ClearMoving();
+	std::vector<ObjectRecord> statics(world.static_objects.size(), ObjectRecord());
+	for (size_t i = 0; i < statics.size(); ++i) {
+		world.static_objects[i]->Write(statics[i]);
+	}
+	std::vector<char> kept(statics.size(), 0);
+	std::vector<const ObjectRecord*> rebuilt;
+	for (size_t i = 0; i < count; ++i) {
+		size_t same = 0;
+		while (same < statics.size() && (kept[same] || memcmp(&statics[same], &records[i], sizeof(ObjectRecord)) != 0)) {
+			++same;
+		}
+		if (same < statics.size()) {
+			kept[same] = 1;
+		}
+		else {
+			rebuilt.push_back(&records[i]);
+		}
+	}
+	world.RemoveDead(std::vector<char>(), kept, [](Object*) {});
 
-	glfwPollEvents();
-	glfwSetCursorPos(window, w / 2, h / 2);
+	for (const ObjectRecord* record : rebuilt) {
+		Object* new_obj = MakeObject(ObjectType(record->type));
+		if (new_obj == nullptr) {
+			continue;
+		}
+		new_obj->Read(*record);
+		world.Add(new_obj);
+	}
+	player = world.objects[0]->GetHandle();
+}
 
-	glClearColor(0.05f, 0.05f, 0.05f, 0.0f);
+// Takes the snapshot here and leaves packing and writing to the writer's thread.
+// Returns the seconds the game thread spent on it.
+double SaveInBackground(const std::string& file, World& world, SaveWriter& writer) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	writer.Save(file, save_version, GameTime(), SaveTypes(), CaptureRecords(world));
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
+// Records are read straight from the mapped file. Type ids are matched by name, so
+// reordering ObjectType keeps saves readable, types that are gone are skipped.
+bool LoadBinary(const std::string& file, World& world, Handle& player) {
+	SaveReader reader;
+	if (!reader.Open(file, save_version, sizeof(ObjectRecord))) {
+		printf("Can't load %s: %s\n", file.c_str(), reader.Error());
+		return false;
+	}
 
-	GLuint VertexArrayID;
-	glGenVertexArrays(1, &VertexArrayID);
-	glBindVertexArray(VertexArrayID);
+	std::unordered_map<uint32_t, ObjectType> type_of;
+	for (uint32_t t = 0; t < reader.TypeCount(); ++t) {
+		const SaveType& saved = reader.Types()[t];
+		std::string name(saved.name, std::find(saved.name, saved.name + sizeof(saved.name), '\0'));
+		for (size_t i = 0; i < object_type_count; ++i) {
+			if (name == object_type_names[i]) {
+				type_of[saved.id] = ObjectType(i);
+			}
+		}
+	}
 
-	GLuint programID = LoadShaders("TextureVertex.vertexshader", "TextureFragment.fragmentshader");
-	GLuint simpleProgramID = LoadShaders("ColorVertex.vertexshader", "ColorFragment.fragmentshader");
+	const ObjectRecord* records = static_cast<const ObjectRecord*>(reader.Records());
+	std::vector<Object*> new_objects;
+	new_objects.reserve(size_t(reader.RecordCount()));
+	for (uint64_t i = 0; i < reader.RecordCount(); ++i) {
+		auto type = type_of.find(records[i].type);
+		if (type == type_of.end()) {
+			continue;
+		}
+		Object* new_obj = MakeObject(type->second);
+		if (new_obj == nullptr) {
+			continue;
+		}
+		new_obj->Read(records[i]);
+		new_objects.push_back(new_obj);
+	}
 
-	GLuint ProjectionID = glGetUniformLocation(programID, "Projection");
-	GLuint ViewID = glGetUniformLocation(programID, "View");
-	GLuint ModelID = glGetUniformLocation(programID, "Model");
-	GLuint TextureID = glGetUniformLocation(programID, "TextureSampler");
-	GLuint LightID = glGetUniformLocation(programID, "LightPositions_worldspace");
-	GLuint LightColorID = glGetUniformLocation(programID, "LightColors");
-	GLuint LightPowerID = glGetUniformLocation(programID, "LightPowers");
-	GLuint AmbientID = glGetUniformLocation(programID, "Ambient");
-	GLuint SpecularID = glGetUniformLocation(programID, "Specular");
-	GLuint NumID = glGetUniformLocation(programID, "LightSources");
+	if (new_objects.empty() || new_objects[0]->Type() != ObjectType::Player) {
+		printf("Can't load %s: no player\n", file.c_str());
+		for (Object* new_obj : new_objects) {
+			delete new_obj;
+		}
+		return false;
+	}
+	ReplaceWorld(world, reader.Time(), new_objects, player);
+	return true;
+}
 
-	GLuint SimpleTextureID = glGetUniformLocation(simpleProgramID, "TextureSampler");
-	GLuint SimpleProjectionID = glGetUniformLocation(simpleProgramID, "Projection");
-	GLuint SimpleViewID = glGetUniformLocation(simpleProgramID, "View");
-	GLuint SimpleModelID = glGetUniformLocation(simpleProgramID, "Model");
-	GLuint SimpleMoveID = glGetUniformLocation(simpleProgramID, "Move");
+// The dynamic_cast dispatch the type table replaced, kept to measure it against.
+bool RttiInterract(Object* obj, Object* other, const glm::vec3& old_position) {
+	Actor* actor = dynamic_cast<Actor*>(obj);
+	if (actor != nullptr) {
+		if (actor->CheckInterraction(other) && other->CheckInterraction(actor)) {
+			Projectile* proj = dynamic_cast<Projectile*>(other);
+			if (proj != nullptr) {
+				if (!proj->Exploded()) {
+					actor->ReceiveDamage(proj->DealDamage(actor));
+				}
+			}
+			if (dynamic_cast<Actor*>(other) != nullptr) {
+				actor->MoveTo(old_position);
+			}
+			if (dynamic_cast<Floor*>(other) != nullptr) {
+				actor->MoveTo(old_position);
+			}
+			return actor->HP() > 0.0f;
+		}
+		return true;
+	}
 
-	GLuint vertexbuffer;
-	glGenBuffers(1, &vertexbuffer);
+	Projectile* proj = dynamic_cast<Projectile*>(obj);
+	if (proj != nullptr && !proj->Exploded()) {
+		if (dynamic_cast<Floor*>(other) != nullptr) {
+			if (other->CheckInterraction(proj)) {
+				proj->MarkInterracted();
+			}
+		}
+		else if (proj->CheckInterraction(other) && other->CheckInterraction(proj)) {
+			if (dynamic_cast<Actor*>(other) != nullptr) {
+				proj->MarkInterracted();
+			}
+		}
+	}
+	return true;
+}
 
-	GLuint uvbuffer;
-	glGenBuffers(1, &uvbuffer);
+// Per pair cost of both dispatch paths over a dense mixed crowd, run with --bench-interract.
+void BenchmarkInterract(size_t count, size_t rounds) {
+	std::mt19937 rng(0);
+	std::uniform_real_distribution<> coord(-5.0, 5.0);
+
+	std::vector<Object*> crowd;
+	crowd.push_back(new Floor(glm::vec3()));
+	for (size_t i = 0; i < count; ++i) {
+		glm::vec3 position(coord(rng), 1.0f + coord(rng) * 0.2f, coord(rng));
+		switch (i % 3) {
+		case 0:
+			crowd.push_back(new Dummy(position, glm::vec3(), 1.0f, 1e9f));
+			break;
+		case 1:
+			crowd.push_back(new Enemy(position, glm::vec3(), 1.0f, 1e9f));
+			break;
+		default:
+			crowd.push_back(new Projectile(position, glm::vec3(1.0f, 0.0f, 0.0f)));
+			break;
+		}
+	}
 
-	GLuint normalbuffer;
-	glGenBuffers(1, &normalbuffer);
+	auto run = [&](auto interract) {
+		size_t remaining = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (size_t round = 0; round < rounds; ++round) {
+			for (size_t i = 0; i < crowd.size(); ++i) {
+				for (size_t j = i + 1; j < crowd.size(); ++j) {
+					remaining += interract(crowd[i], crowd[j], crowd[i]->Position());
+					remaining += interract(crowd[j], crowd[i], crowd[j]->Position());
+				}
+			}
+		}
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+		size_t pairs = rounds * crowd.size() * (crowd.size() - 1) / 2;
+		printf("%.2f ns per pair (%zu)\n", elapsed.count() / pairs, remaining);
+	};
 
-	initText2D("Holstein.DDS");
+	printf("dynamic_cast: ");
+	run(&RttiInterract);
+	printf("type table:   ");
+	run([](Object* obj, Object* other, const glm::vec3& old_position) {
+		Contact contact;
+		return !Interract(obj, other, contact) || Resolve(obj, contact, old_position);
+	});
 
-	Player* player = new Player();
-	Skybox* skybox = new Skybox(player->Position());
+	for (Object* obj : crowd) {
+		delete obj;
+	}
+}
 
-	std::vector<Object*> objects;
-	objects.push_back(player);
-	objects.push_back(new Floor(player->Position() - glm::vec3(0.0f, player->Position().y, 0.0f)));
+// One object to draw, copied out of the world.
+struct RenderItem {
+	// Model matrix of the last tick, drawn with the translation moved between the two positions.
+	glm::mat4 model;
+	glm::vec3 position;
+	glm::vec3 previous_position;
+	std::shared_ptr<const Mesh> mesh;
+	// Lit by the texture shader, otherwise drawn flat by the color shader.
+	bool lit;
+	// Explosion offset for the color shader.
+	GLfloat move;
+};
 
+// Everything a frame shows. Filled by the simulation, never changed once published.
+struct FrameSnapshot {
+	glm::mat4 projection;
+	// Camera at the last tick and the one before.
+	glm::vec3 eye;
+	glm::vec3 previous_eye;
+	glm::vec3 look;
+	glm::vec3 previous_look;
+	glm::vec3 up;
+	std::vector<RenderItem> items;
+	std::vector<glm::vec3> light_positions;
+	std::vector<glm::vec3> light_previous_positions;
+	std::vector<glm::vec3> light_colors;
+	std::vector<GLfloat> light_powers;
+	GLfloat hp = 0.0f;
+	size_t killed = 0;
+	size_t enemies = 0;
+	// Ticks are numbered from 1, 0 means nothing was published yet.
+	uint64_t tick = 0;
+	GLfloat tick_ms = 0.0f;
+	int substeps = 1;
+	// Wall time a tick stands for at the current time scale. Frames move from the
+	// previous state to the last one over that long after it was published.
+	double tick_interval = 1.0;
+	std::chrono::steady_clock::time_point published;
+};
 
-	GLfloat prev_time = glfwGetTime();
-	GLfloat timespeed = 1.0f;
+struct RenderStats {
+	uint64_t frames = 0;
+	// Snapshots shown, and published ones replaced before they could be.
+	uint64_t snapshots = 0;
+	uint64_t skipped = 0;
+	// From publishing a snapshot to presenting it, in seconds.
+	double latency_sum = 0.0;
+	double latency_max = 0.0;
+	// Seconds spent drawing, and the part of it the simulation was ticking too.
+	double busy = 0.0;
+	double overlap = 0.0;
+};
 
-	EnemyCreator enemy_creator;
+// Draws on its own thread, which owns the GL context between Start and Stop.
+// It only reads snapshots, so a slow frame never holds up the simulation and a
+// slow tick never holds up presenting, the last snapshot is drawn again further
+// along between its two ticks.
+class Renderer {
+public:
+	explicit Renderer(GLFWwindow* window) : window_(window) {}
 
-	bool saved = false;
-	bool loaded = false;
+	// Takes the context away from the calling thread.
+	void Start() {
+		glfwMakeContextCurrent(NULL);
+		running_ = true;
+		thread_ = std::thread(&Renderer::Run, this);
+	}
+
+	void Stop() {
+		running_ = false;
+		thread_.join();
+	}
+
+	TripleBuffer<FrameSnapshot>& Snapshots() { return snapshots_; }
+
+	// Called by the simulation after each tick.
+	void AddTickTime(double seconds) {
+		sim_busy_ns_.fetch_add(int64_t(seconds * 1e9), std::memory_order_relaxed);
+	}
+
+	// Only read it after Stop.
+	const RenderStats& Stats() const { return stats_; }
+
+	// Seconds the last frame took to draw, readable while running.
+	double DrawTime() const {
+		return draw_ns_.load(std::memory_order_relaxed) * 1e-9;
+	}
+
+private:
+	struct GpuMesh {
+		std::weak_ptr<const Mesh> mesh;
+		GLuint vertices;
+		GLuint uvs;
+		GLuint normals;
+		GLuint texture;
+		GLsizei count;
+	};
+
+	void Run() {
+		glfwMakeContextCurrent(window_);
+		glfwSwapInterval(1);
+
+		glClearColor(0.05f, 0.05f, 0.05f, 0.0f);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+
+		GLuint VertexArrayID;
+		glGenVertexArrays(1, &VertexArrayID);
+		glBindVertexArray(VertexArrayID);
+
+		program_ = LoadShaders("TextureVertex.vertexshader", "TextureFragment.fragmentshader");
+		simple_program_ = LoadShaders("ColorVertex.vertexshader", "ColorFragment.fragmentshader");
+
+		projection_id_ = glGetUniformLocation(program_, "Projection");
+		view_id_ = glGetUniformLocation(program_, "View");
+		model_id_ = glGetUniformLocation(program_, "Model");
+		texture_id_ = glGetUniformLocation(program_, "TextureSampler");
+		light_id_ = glGetUniformLocation(program_, "LightPositions_worldspace");
+		light_color_id_ = glGetUniformLocation(program_, "LightColors");
+		light_power_id_ = glGetUniformLocation(program_, "LightPowers");
+		ambient_id_ = glGetUniformLocation(program_, "Ambient");
+		specular_id_ = glGetUniformLocation(program_, "Specular");
+		num_id_ = glGetUniformLocation(program_, "LightSources");
+
+		simple_texture_id_ = glGetUniformLocation(simple_program_, "TextureSampler");
+		simple_projection_id_ = glGetUniformLocation(simple_program_, "Projection");
+		simple_view_id_ = glGetUniformLocation(simple_program_, "View");
+		simple_model_id_ = glGetUniformLocation(simple_program_, "Model");
+		simple_move_id_ = glGetUniformLocation(simple_program_, "Move");
+
+		initText2D("Holstein.DDS");
+
+		uint64_t last_tick = 0;
+		uint64_t second_frames = 0;
+		std::chrono::steady_clock::time_point second_start = std::chrono::steady_clock::now();
+
+		while (running_) {
+			bool fresh = snapshots_.Update();
+			const FrameSnapshot& snapshot = snapshots_.ReadBuffer();
+			if (snapshot.tick == 0) {
+				std::this_thread::yield();
+				continue;
+			}
+			if (fresh) {
+				++stats_.snapshots;
+				if (last_tick != 0) {
+					stats_.skipped += snapshot.tick - last_tick - 1;
+				}
+				last_tick = snapshot.tick;
+			}
+
+			std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+			int64_t sim_before = sim_busy_ns_.load(std::memory_order_relaxed);
+
+			Draw(snapshot);
+
+			std::chrono::duration<double> busy = std::chrono::steady_clock::now() - begin;
+			double sim_busy = (sim_busy_ns_.load(std::memory_order_relaxed) - sim_before) * 1e-9;
+			stats_.busy += busy.count();
+			draw_ns_.store(int64_t(busy.count() * 1e9), std::memory_order_relaxed);
+			stats_.overlap += std::min(busy.count(), sim_busy);
+
+			glfwSwapBuffers(window_);
+			++stats_.frames;
+			++second_frames;
+
+			if (fresh) {
+				std::chrono::duration<double> latency = std::chrono::steady_clock::now() - snapshot.published;
+				stats_.latency_sum += latency.count();
+				stats_.latency_max = std::max(stats_.latency_max, latency.count());
+				last_latency_ = latency.count();
+			}
+
+			std::chrono::duration<double> second = std::chrono::steady_clock::now() - second_start;
+			if (second.count() >= 1.0) {
+				frame_rate_ = second_frames / second.count();
+				second_frames = 0;
+				second_start = std::chrono::steady_clock::now();
+				ReleaseUnused();
+			}
+		}
+
+		for (std::pair<const Mesh* const, GpuMesh>& entry : meshes_) {
+			DeleteBuffers(entry.second);
+		}
+		meshes_.clear();
+		for (std::pair<const std::string, GLuint>& entry : textures_) {
+			glDeleteTextures(1, &entry.second);
+		}
+		textures_.clear();
+
+		cleanupText2D();
+		glDeleteProgram(program_);
+		glDeleteProgram(simple_program_);
+		glDeleteVertexArrays(1, &VertexArrayID);
+
+		glfwMakeContextCurrent(NULL);
+	}
+
+	void Draw(const FrameSnapshot& snapshot) {
+		std::chrono::duration<double> since = std::chrono::steady_clock::now() - snapshot.published;
+		GLfloat alpha = GLfloat(std::min(1.0, since.count() / snapshot.tick_interval));
+
+		glm::vec3 eye = glm::mix(snapshot.previous_eye, snapshot.eye, alpha);
+		glm::mat4 view = glm::lookAt(
+			eye,
+			eye + glm::normalize(glm::mix(snapshot.previous_look, snapshot.look, alpha)),
+			snapshot.up
+		);
 
-	do {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) {
-			if (!saved) {
-				SaveToFile("save.txt", objects);
-				saved = true;
+		glUseProgram(simple_program_);
+
+		glUniformMatrix4fv(simple_projection_id_, 1, GL_FALSE, &snapshot.projection[0][0]);
+		glUniformMatrix4fv(simple_view_id_, 1, GL_FALSE, &view[0][0]);
+
+		for (const RenderItem& item : snapshot.items) {
+			if (!item.lit) {
+				glm::mat4 model = Interpolate(item, alpha);
+				glUniform1fv(simple_move_id_, 1, &item.move);
+				glUniformMatrix4fv(simple_model_id_, 1, GL_FALSE, &model[0][0]);
+
+				DrawMesh(item, simple_texture_id_);
 			}
 		}
-		if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE) {
-			saved = false;
+
+		glUseProgram(program_);
+
+		glUniformMatrix4fv(projection_id_, 1, GL_FALSE, &snapshot.projection[0][0]);
+		glUniformMatrix4fv(view_id_, 1, GL_FALSE, &view[0][0]);
+
+		int num = std::min(snapshot.light_positions.size(), size_t(ShaderNum));
+
+		light_positions_.clear();
+		for (int i = 0; i < num; ++i) {
+			light_positions_.push_back(glm::mix(snapshot.light_previous_positions[i], snapshot.light_positions[i], alpha));
 		}
 
-		if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) {
-			if (!loaded) {
-				LoadFromFile("save.txt", objects, player, prev_time);
-				loaded = true;
+		if (num > 0) {
+			glUniform1iv(num_id_, 1, &num);
+			glUniform3fv(light_id_, num, &light_positions_[0][0]);
+			glUniform3fv(light_color_id_, num, &snapshot.light_colors[0][0]);
+			glUniform1fv(light_power_id_, num, &snapshot.light_powers[0]);
+		} else {
+			glUniform1iv(num_id_, 1, &num);
+		}
+
+		glm::vec3 light = glm::vec3(0.5f, 0.5f, 0.5f);
+		glUniform3fv(specular_id_, 1, &light[0]);
+		light = glm::vec3(0.3f, 0.3f, 0.3f);
+		glUniform3fv(ambient_id_, 1, &light[0]);
+
+		for (const RenderItem& item : snapshot.items) {
+			if (item.lit) {
+				glm::mat4 model = Interpolate(item, alpha);
+				glUniformMatrix4fv(model_id_, 1, GL_FALSE, &model[0][0]);
+
+				DrawMesh(item, texture_id_);
 			}
 		}
-		if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE) {
-			loaded = false;
+
+		char frame_text[128];
+		snprintf(frame_text, sizeof(frame_text), "Frame: %.0f fps, tick %.1f ms x%d, latency %.1f ms",
+			frame_rate_, snapshot.tick_ms, snapshot.substeps, last_latency_ * 1000.0);
+
+		printText2D(std::string("HP: " + std::to_string(snapshot.hp)).data(), 10, 550, 20);
+		printText2D(std::string("Killed: " + std::to_string(snapshot.killed)).data(), 10, 530, 20);
+		printText2D(std::string("Current enemies: " + std::to_string(snapshot.enemies)).data(), 10, 510, 20);
+		printText2D(frame_text, 10, 490, 20);
+	}
+
+	static glm::mat4 Interpolate(const RenderItem& item, GLfloat alpha) {
+		glm::mat4 model = item.model;
+		model[3] = glm::vec4(glm::mix(item.previous_position, item.position, alpha), 1.0f);
+		return model;
+	}
+
+	void DrawMesh(const RenderItem& item, GLuint texture_id) {
+		const GpuMesh& gpu = Upload(item.mesh);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, gpu.texture);
+		glUniform1i(texture_id, 0);
+
+		glEnableVertexAttribArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.vertices);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glEnableVertexAttribArray(1);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.uvs);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.normals);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glDrawArrays(GL_TRIANGLES, 0, gpu.count);
+
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
+		glDisableVertexAttribArray(2);
+	}
+
+	// Buffers of a mesh, uploaded the first time it is drawn.
+	const GpuMesh& Upload(const std::shared_ptr<const Mesh>& mesh) {
+		std::map<const Mesh*, GpuMesh>::iterator found = meshes_.find(mesh.get());
+		if (found != meshes_.end()) {
+			// A freed mesh may have left its address to a new one.
+			if (found->second.mesh.lock() == mesh) {
+				return found->second;
+			}
+			DeleteBuffers(found->second);
+			meshes_.erase(found);
 		}
 
-		skybox->MoveTo(player->Position());
+		GpuMesh gpu;
+		gpu.mesh = mesh;
+		gpu.count = GLsizei(mesh->vertices.size());
+		gpu.texture = Texture(mesh->texture_file);
+
+		glGenBuffers(1, &gpu.vertices);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.vertices);
+		glBufferData(GL_ARRAY_BUFFER, mesh->vertices.size() * sizeof(glm::vec3), mesh->vertices.data(), GL_STATIC_DRAW);
 
-		timespeed = 1.0f;
+		glGenBuffers(1, &gpu.uvs);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.uvs);
+		glBufferData(GL_ARRAY_BUFFER, mesh->uvs.size() * sizeof(glm::vec2), mesh->uvs.data(), GL_STATIC_DRAW);
 
-		if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
-			timespeed *= time_coef;
+		glGenBuffers(1, &gpu.normals);
+		glBindBuffer(GL_ARRAY_BUFFER, gpu.normals);
+		glBufferData(GL_ARRAY_BUFFER, mesh->normals.size() * sizeof(glm::vec3), mesh->normals.data(), GL_STATIC_DRAW);
+
+		return meshes_[mesh.get()] = gpu;
+	}
+
+	GLuint Texture(const std::string& file) {
+		std::map<std::string, GLuint>::iterator found = textures_.find(file);
+		if (found != textures_.end()) {
+			return found->second;
 		}
+		return textures_[file] = loadDDS(file.data());
+	}
 
-		if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
-			timespeed *= 1.0f / time_coef;
+	// Drops buffers of meshes nothing uses any more, like the floor of a replaced level.
+	void ReleaseUnused() {
+		for (std::map<const Mesh*, GpuMesh>::iterator it = meshes_.begin(); it != meshes_.end();) {
+			if (it->second.mesh.expired()) {
+				DeleteBuffers(it->second);
+				it = meshes_.erase(it);
+			}
+			else {
+				++it;
+			}
 		}
+	}
 
-		GLfloat timediff = (glfwGetTime() - prev_time) * timespeed;
-		glfwSetTime(prev_time + timediff);
-		GLfloat current_time = glfwGetTime();
+	static void DeleteBuffers(GpuMesh& gpu) {
+		glDeleteBuffers(1, &gpu.vertices);
+		glDeleteBuffers(1, &gpu.uvs);
+		glDeleteBuffers(1, &gpu.normals);
+	}
 
-		std::vector<glm::vec3> old_positions;
+	GLFWwindow* window_;
+	std::thread thread_;
+	std::atomic<bool> running_{ false };
+	TripleBuffer<FrameSnapshot> snapshots_;
+	std::atomic<int64_t> sim_busy_ns_{ 0 };
+	std::atomic<int64_t> draw_ns_{ 0 };
+	RenderStats stats_;
+	double frame_rate_ = 0.0;
+	double last_latency_ = 0.0;
+
+	// Render thread only.
+	std::vector<glm::vec3> light_positions_;
+	std::map<const Mesh*, GpuMesh> meshes_;
+	std::map<std::string, GLuint> textures_;
+
+	GLuint program_;
+	GLuint simple_program_;
+
+	GLuint projection_id_;
+	GLuint view_id_;
+	GLuint model_id_;
+	GLuint texture_id_;
+	GLuint light_id_;
+	GLuint light_color_id_;
+	GLuint light_power_id_;
+	GLuint ambient_id_;
+	GLuint specular_id_;
+	GLuint num_id_;
+
+	GLuint simple_texture_id_;
+	GLuint simple_projection_id_;
+	GLuint simple_view_id_;
+	GLuint simple_model_id_;
+	GLuint simple_move_id_;
+};
 
-		for (Object* obj : objects) {
-			old_positions.push_back(obj->Position());
-			obj->Move(obj->GetDirection() * obj->GetSpeed() * timediff);
+// The window with its GL context, current on the calling thread. False if there is none to have.
+bool OpenWindow() {
+	if (!glfwInit())
+	{
+		fprintf(stderr, "Failed to initialize GLFW\n");
+		getchar();
+		return false;
+	}
+
+	glfwWindowHint(GLFW_SAMPLES, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	window = glfwCreateWindow(w, h, "Shooter", NULL, NULL);
+	if (window == NULL) {
+		fprintf(stderr, "Failed to open GLFW window.\n");
+		getchar();
+		glfwTerminate();
+		return false;
+	}
+	glfwMakeContextCurrent(window);
+
+	glewExperimental = true;
+	if (glewInit() != GLEW_OK) {
+		fprintf(stderr, "Failed to initialize GLEW\n");
+		getchar();
+		glfwTerminate();
+		return false;
+	}
+
+	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
+	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	glfwPollEvents();
+	glfwSetCursorPos(window, w / 2, h / 2);
+	return true;
+}
+
+// Floors built by a load take their BVH right away, see Floor::AwaitBvh.
+void AwaitStatics(World& world) {
+	for (Object* obj : world.static_objects) {
+		if (obj->Type() == ObjectType::Floor) {
+			static_cast<Floor*>(obj)->AwaitBvh();
 		}
+	}
+}
 
-		prev_time = current_time;
+int main(int argc, char** argv)
+{
+	double tick_rate = default_tick_rate;
+	std::string waves;
+	std::string record;
+	std::string replay;
+	bool headless = false;
+	uint32_t seed = std::random_device()();
+	for (int i = 1; i < argc; ++i) {
+		if (std::string(argv[i]) == "--headless") {
+			headless = true;
+		}
+		if (i + 1 >= argc) {
+			continue;
+		}
+		if (std::string(argv[i]) == "--tick-rate") {
+			tick_rate = std::max(1.0, atof(argv[i + 1]));
+		}
+		if (std::string(argv[i]) == "--waves") {
+			waves = argv[i + 1];
+		}
+		if (std::string(argv[i]) == "--seed") {
+			seed = uint32_t(strtoul(argv[i + 1], NULL, 10));
+		}
+		if (std::string(argv[i]) == "--record") {
+			record = argv[i + 1];
+		}
+		if (std::string(argv[i]) == "--replay") {
+			replay = argv[i + 1];
+		}
+	}
 
-		std::vector<bool> remains(objects.size(), true);
+	// A replay takes the seed and tick rate of its recording.
+	InputLog input_log;
+	if (!replay.empty()) {
+		if (!input_log.Load(replay)) {
+			fprintf(stderr, "Impossible to replay %s\n", replay.c_str());
+			return -1;
+		}
+		seed = input_log.Seed();
+		tick_rate = input_log.TickRate();
+	}
+	else {
+		input_log.Start(seed, tick_rate);
+	}
+	// Only replays run without a window, there is no input to take otherwise.
+	headless = headless && !replay.empty();
+	// Recorded and replayed sessions must come out the same, so no budget of wall time
+	// may decide anything in them.
+	const bool deterministic = !record.empty() || !replay.empty();
+	const double unlimited = std::numeric_limits<double>::infinity();
+
+	if (!headless && !OpenWindow()) {
+		return -1;
+	}
 
-		for (size_t i = 0; i < objects.size(); ++i) {
-			remains[i] = objects[i]->CheckSelf();
+	if (argc > 1 && std::string(argv[1]) == "--bench-interract") {
+		BenchmarkInterract(300, 20);
+		glfwTerminate();
+		return 0;
+	}
+
+	World world;
+	// Only the handle outlives a tick, the player is looked up through it every tick.
+	Handle player_handle = world.Add(new Player());
+	Player* player = static_cast<Player*>(world.Get(player_handle));
+	Skybox* skybox = new Skybox(player->Position());
+
+	world.Add(new Floor(player->Position() - glm::vec3(0.0f, player->Position().y, 0.0f)));
+	if (deterministic) {
+		AwaitStatics(world);
+	}
+
+	std::vector<Object*>& objects = world.objects;
+
+	const double tick_length = 1.0 / tick_rate;
+
+	// The simulation budget is per frame of default_tick_rate, the director measures ticks.
+	SpawnDirector director(deterministic ? unlimited : sim_budget * tick_length * default_tick_rate,
+		deterministic ? unlimited : render_budget, max_live_objects);
+	if (!waves.empty() && !director.LoadScript(waves)) {
+		printf("Impossible to open %s, spawning by load instead\n", waves.c_str());
+	}
+	double accumulator = 0.0;
+	double dropped_time = 0.0;
+	std::chrono::steady_clock::time_point previous_pass = std::chrono::steady_clock::now();
+
+	GLfloat timespeed = 1.0f;
+
+	EnemyCreator enemy_creator(seed);
+
+	JobSystem jobs;
+	StepGovernor governor(1.0 / default_tick_rate, deterministic ? unlimited : sim_budget, max_substeps, max_substep_travel);
+	AiScheduler ai(ai_near_distance, deterministic ? unlimited : ai_budget);
+	std::vector<size_t> thinkers;
+	std::vector<size_t> due;
+
+	FlowField flow;
+	std::future<FlowField> pending_flow;
+	uint64_t flow_due = 0;
+	int flow_x = 0;
+	int flow_z = 0;
+	uint64_t flow_statics = 0;
+	bool flow_requested = false;
+	std::vector<FlowObstacle> obstacles;
+
+	CrowdSoA crowd;
+	CrowdGrid crowd_grid;
+	std::vector<size_t> crowd_agents;
+
+	ProjectileSoA projectile_state;
+	std::vector<size_t> projectile_slots;
+
+	SphereSoA spheres;
+	std::vector<uint32_t> pair_a;
+	std::vector<uint32_t> pair_b;
+	std::vector<uint64_t> pair_hits;
+
+	std::vector<std::pair<uint32_t, uint32_t>> contact_pairs;
+	std::vector<std::vector<Contact>> contact_buffers(jobs.ThreadCount());
+	std::vector<Contact> contacts;
+
+	CommandBuffer commands(jobs.ThreadCount());
+	auto on_remove = [&](Object* obj) {
+		if (IsEnemy(obj->Type())) {
+			player->Kill();
 		}
+	};
+	std::vector<Object*> drawn;
+	std::vector<glm::mat4> models;
 
-		for (size_t i = 0; i < objects.size(); ++i) {
-			for (size_t j = i + 1; j < objects.size(); ++j) {
-				remains[i] = remains[i] && objects[i]->Interract(objects[j], old_positions[i]);
-				remains[j] = remains[j] && objects[j]->Interract(objects[i], old_positions[j]);
+	bool saved = false;
+	bool loaded = false;
+	bool exported = false;
+	SaveWriter save_writer;
+	double next_autosave = game_time + autosave_interval;
+	uint64_t snapshots = 0;
+	double snapshot_seconds = 0.0;
+	double snapshot_max = 0.0;
+	auto save_snapshot = [&](const std::string& file) {
+		double seconds = SaveInBackground(file, world, save_writer);
+		++snapshots;
+		snapshot_seconds += seconds;
+		snapshot_max = std::max(snapshot_max, seconds);
+	};
+
+	bool rewound = false;
+	SnapshotRing rewind_ring(rewind_memory, rewind_keyframe_every);
+	std::vector<ObjectRecord> rewind_records;
+	std::vector<char> rewind_bytes;
+	double rewind_push_seconds = 0.0;
+	double rewind_restore_seconds = 0.0;
+	double rewind_restore_max = 0.0;
+
+	// Input and simulation stay on this thread, GLFW wants its events handled here.
+	Renderer renderer(window);
+	if (!headless) {
+		renderer.Start();
+	}
+	uint64_t tick = 0;
+	std::chrono::steady_clock::time_point session_start = std::chrono::steady_clock::now();
+
+	do {
+		std::chrono::steady_clock::time_point tick_start = std::chrono::steady_clock::now();
+
+		// Headless replays run tick after tick as fast as they go, the rest keeps to the clock.
+		if (!headless) {
+			timespeed = 1.0f;
+
+			if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) {
+				timespeed *= time_coef;
 			}
-		}
 
-		if (!remains[0]) {
-			break;
+			if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS) {
+				timespeed *= 1.0f / time_coef;
+			}
+
+			// Wall time goes into the accumulator scaled by the time keys, every pass runs
+			// at most one tick and only once a whole tick length has built up.
+			std::chrono::duration<double> elapsed = tick_start - previous_pass;
+			previous_pass = tick_start;
+			accumulator += elapsed.count() * timespeed;
+
+			if (accumulator < tick_length) {
+				glfwPollEvents();
+				std::this_thread::sleep_for(std::chrono::duration<double>((tick_length - accumulator) / timespeed));
+				continue;
+			}
+			if (accumulator > max_catch_up_ticks * tick_length) {
+				dropped_time += accumulator - max_catch_up_ticks * tick_length;
+				accumulator = max_catch_up_ticks * tick_length;
+			}
+		}
+		// Out of budget for this frame: the backlog is dropped, so the game slows down
+		// instead of taking ever more CPU, fast forward included.
+		if (!governor.BeginTick()) {
+			dropped_time += accumulator;
+			accumulator = 0.0;
+			glfwPollEvents();
+			continue;
 		}
+		accumulator -= tick_length;
 
-		std::vector<Object*> new_objects;
+		// Everything the player does in this tick comes from one input frame.
+		InputFrame input;
+		if (!replay.empty()) {
+			if (!input_log.Next(input)) {
+				break;
+			}
+		}
+		else {
+			input = SampleInput();
+			if (!record.empty()) {
+				input_log.Record(input);
+			}
+		}
 
-		for (size_t i = 0; i < objects.size(); ++i) {
-			if (remains[i]) { 
-				new_objects.push_back(objects[i]);
+		if (input.Held(button_save)) {
+			if (!saved) {
+				save_snapshot("save.bin");
+				saved = true;
 			}
-			else {
-				if (dynamic_cast<Dummy*>(objects[i]) != nullptr || dynamic_cast<Enemy*>(objects[i]) != nullptr) {
-					player->Kill();
+		}
+		else {
+			saved = false;
+		}
+
+		if (game_time >= next_autosave) {
+			save_snapshot("autosave.bin");
+			next_autosave = game_time + autosave_interval;
+		}
+
+		// A replay loads whatever save is on disk, it only follows its recording with the same file.
+		if (input.Held(button_load)) {
+			if (!loaded) {
+				if (!LoadBinary("save.bin", world, player_handle)) {
+					LoadFromFile("save.txt", world, player_handle);
+				}
+				if (deterministic) {
+					AwaitStatics(world);
 				}
-				delete objects[i];
+				next_autosave = game_time + autosave_interval;
+				rewind_ring.Clear();
+				loaded = true;
 			}
 		}
+		else {
+			loaded = false;
+		}
 
-		std::vector<Object*> act_objects;
+		if (input.Held(button_rewind)) {
+			if (!rewound && !rewind_ring.Empty()) {
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				double at;
+				if (rewind_ring.Rewind(std::max(game_time - rewind_seconds, rewind_ring.Oldest()), rewind_bytes, at)) {
+					RestoreRecords(world, at, reinterpret_cast<const ObjectRecord*>(rewind_bytes.data()),
+						rewind_bytes.size() / sizeof(ObjectRecord), player_handle);
+					if (deterministic) {
+						AwaitStatics(world);
+					}
+					next_autosave = game_time + autosave_interval;
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				rewind_restore_seconds += seconds;
+				rewind_restore_max = std::max(rewind_restore_max, seconds);
+			}
+			rewound = true;
+		}
+		else {
+			rewound = false;
+		}
 
-		for (size_t i = 0; i < new_objects.size(); ++i) {
-			act_objects.push_back(new_objects[i]);
-			Object* new_obj = new_objects[i]->Act(new_objects);
-			if (new_obj != nullptr) {
-				act_objects.push_back(new_obj);
+		if (input.Held(button_export)) {
+			if (!exported) {
+				SaveToFile("save.txt", world);
+				exported = true;
 			}
 		}
+		else {
+			exported = false;
+		}
+
+		player = static_cast<Player*>(world.Get(player_handle));
+		player->SetInput(input);
+		skybox->MoveTo(player->Position());
 
-		objects = act_objects;
+		double tick_begin = game_time;
+		game_time += tick_length;
+		glm::vec3 previous_look = player->CameraDirection();
 
-	    Object* new_obj = enemy_creator.CreateEnemy(player->Position(), objects);
-		if (new_obj != nullptr) {
-			objects.push_back(new_obj);
+		for (Object* obj : objects) {
+			obj->StartTick();
 		}
 
-		glm::mat4 Projection = glm::perspective(glm::radians(player->FOV()), GLfloat(w / h), player->Box(), 300.0f);
-		glm::mat4 View = glm::lookAt(
-			player->Position(),
-			player->Position() + player->CameraDirection(),
-			player->CameraUp()
-		);
+		// Movement, contacts and removal run once per substep, acting once per tick.
+		// The split asked for depends only on the state, the governor cuts it to one
+		// substep when the frame runs short of budget.
+		GLfloat travel = 0.0f;
+		for (Object* obj : objects) {
+			if (obj->Box() > 0.0f) {
+				travel = std::max(travel, glm::length(obj->GetDirection()) * obj->GetSpeed() * GLfloat(tick_length) / obj->Box());
+			}
+		}
+		int substeps = governor.Substeps(travel);
+		bool player_died = false;
+
+		for (int substep = 0; substep < substeps; ++substep) {
+			GLfloat timediff = GLfloat(tick_length / substeps);
+			double step_time = tick_begin + tick_length * (substep + 1) / substeps;
+
+			std::vector<glm::vec3> old_positions(objects.size());
+
+			// Projectiles are gathered into SoA arrays and integrated in one pass.
+			projectile_state.Clear();
+			projectile_slots.clear();
+
+			for (size_t i = 0; i < objects.size(); ++i) {
+				Object* obj = objects[i];
+				old_positions[i] = obj->Position();
+				if (obj->Type() == ObjectType::Projectile) {
+					Projectile* proj = static_cast<Projectile*>(obj);
+					projectile_state.Push(proj->Position(), proj->GetDirection() * proj->GetSpeed());
+					projectile_slots.push_back(i);
+				}
+			}
 
-		glUseProgram(simpleProgramID);
+			// The rest moves in jobs next to the kernel, projectile positions are written back once it is done.
+			JobCounter integrated;
+			JobCounter moved;
+			jobs.Run([&]() {
+				IntegrateProjectiles(projectile_state, timediff);
+			}, &integrated);
+			jobs.Run([&]() {
+				for (size_t p = 0; p < projectile_slots.size(); ++p) {
+					objects[projectile_slots[p]]->MoveTo(projectile_state.Position(p));
+				}
+			}, &moved, &integrated);
+			jobs.ParallelFor(0, objects.size(), job_grain, [&](size_t i) {
+				Object* obj = objects[i];
+				if (obj->Type() != ObjectType::Projectile) {
+					obj->Move(obj->GetDirection() * obj->GetSpeed() * timediff);
+				}
+			}, moved);
+			jobs.Wait(moved);
+
+			world.RefitSwept(old_positions);
+			std::vector<std::pair<size_t, size_t>> pairs = world.DynamicPairs();
+			std::vector<std::pair<size_t, size_t>> static_pairs = world.StaticPairs();
+			std::vector<Object*>& static_objects = world.static_objects;
+
+			// Pull fast movers back to their first contact, so big steps cannot skip over small targets.
+			// Pairs that can't interact, such as two projectiles, pass through each other.
+			// Sweeps run in jobs into one slot per pair, the minimum per object is taken afterwards.
+			std::vector<GLfloat> impacts(objects.size(), 1.0f);
+			std::vector<GLfloat> pair_toi(pairs.size() + static_pairs.size(), 1.0f);
+
+			jobs.ParallelFor(0, pair_toi.size(), job_grain, [&](size_t p) {
+				GLfloat toi;
+				if (p < pairs.size()) {
+					size_t i = pairs[p].first;
+					size_t j = pairs[p].second;
+					if (Collides(objects[i], objects[j]) &&
+						SweepPair(objects[i], old_positions[i], objects[j], old_positions[j], toi)) {
+						pair_toi[p] = toi;
+					}
+				}
+				else {
+					size_t i = static_pairs[p - pairs.size()].first;
+					Object* obj = static_objects[static_pairs[p - pairs.size()].second];
+					if (Collides(objects[i], obj) && SweepPair(objects[i], old_positions[i], obj, obj->Position(), toi)) {
+						pair_toi[p] = toi;
+					}
+				}
+			});
 
-		glUniformMatrix4fv(SimpleProjectionID, 1, GL_FALSE, &Projection[0][0]);
-		glUniformMatrix4fv(SimpleViewID, 1, GL_FALSE, &View[0][0]);
+			for (size_t p = 0; p < pairs.size(); ++p) {
+				impacts[pairs[p].first] = std::min(impacts[pairs[p].first], pair_toi[p]);
+				impacts[pairs[p].second] = std::min(impacts[pairs[p].second], pair_toi[p]);
+			}
+			for (size_t p = 0; p < static_pairs.size(); ++p) {
+				size_t i = static_pairs[p].first;
+				impacts[i] = std::min(impacts[i], pair_toi[pairs.size() + p]);
+			}
 
-		GLfloat move = 0.0f;
-		glUniform1fv(SimpleMoveID, 1, &move);
+			for (size_t i = 0; i < objects.size(); ++i) {
+				if (impacts[i] < 1.0f) {
+					objects[i]->Move((old_positions[i] - objects[i]->Position()) * (1.0f - impacts[i]));
+				}
+			}
 
-		glm::mat4 Scale = glm::scale(glm::mat4(), glm::vec3(skybox->Box(), skybox->Box(), skybox->Box()));
-		glm::mat4 Translate = glm::translate(glm::mat4(), skybox->Position());
+			// Cooldowns, flights and explosions ending in this step, projectiles that are over
+			// report it through CheckSelf.
+			AdvanceTimers(step_time);
 
-		glm::mat4 Model = Translate * Scale;
-		glUniformMatrix4fv(SimpleModelID, 1, GL_FALSE, &Model[0][0]);
+			std::vector<char> remains(objects.size(), true);
+			std::vector<char> static_remains(static_objects.size(), true);
 
-		skybox->Draw(SimpleTextureID, vertexbuffer, uvbuffer, normalbuffer);
+			jobs.ParallelFor(0, objects.size(), job_grain, [&](size_t i) {
+				remains[i] = objects[i]->CheckSelf();
+			});
 
-		for (Object* obj : objects) {
-			if (dynamic_cast<Projectile*>(obj) != nullptr) {
-				move = dynamic_cast<Projectile*>(obj)->ExplodedMove();
-				glUniform1fv(SimpleMoveID, 1, &move);
+			// Sphere pairs are tested in one SIMD batch, static spheres follow the moving ones in the arrays.
+			// Only overlapping pairs and pairs with the floor go on to Interract.
+			spheres.Clear();
+			for (Object* obj : objects) {
+				spheres.Push(obj->Position(), obj->Box());
+			}
+			for (Object* obj : static_objects) {
+				spheres.Push(obj->Position(), obj->Box());
+			}
 
-				glm::mat4 Scale = glm::scale(glm::mat4(), glm::vec3(obj->Box(), obj->Box(), obj->Box()) / 1.5f);
-				glm::mat4 Translate = glm::translate(glm::mat4(), obj->Position());
+			pair_a.clear();
+			pair_b.clear();
+			for (const std::pair<size_t, size_t>& pair : pairs) {
+				pair_a.push_back(uint32_t(pair.first));
+				pair_b.push_back(uint32_t(pair.second));
+			}
+			for (const std::pair<size_t, size_t>& pair : static_pairs) {
+				if (static_objects[pair.second]->SphereShape()) {
+					pair_a.push_back(uint32_t(pair.first));
+					pair_b.push_back(uint32_t(objects.size() + pair.second));
+				}
+			}
 
-				glm::vec3 direction = obj->GetDirection();
-				glm::vec3 base_direction(1.0f, 0.0f, 0.0f);
-				glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-				GLfloat sin_value = glm::dot(glm::cross(base_direction, direction), up);
-				GLfloat cos_value = glm::dot(base_direction, direction);
+			pair_hits.resize((pair_a.size() + 63) / 64);
+			OverlapSpherePairs(spheres, pair_a.data(), pair_b.data(), pair_a.size(), pair_hits.data());
 
-				glm::mat4 Rotate = glm::rotate(glm::mat4(), std::atan2(sin_value, cos_value), up);
+			size_t batch = 0;
+			contact_pairs.clear();
 
-				glm::mat4 Model = Translate * Rotate * Scale;
-				glUniformMatrix4fv(SimpleModelID, 1, GL_FALSE, &Model[0][0]);
+			for (const std::pair<size_t, size_t>& pair : pairs) {
+				bool hit = (pair_hits[batch / 64] >> (batch % 64)) & 1;
+				++batch;
+				if (hit) {
+					contact_pairs.push_back(std::make_pair(uint32_t(pair.first), uint32_t(pair.second)));
+				}
+			}
 
-				obj->Draw(SimpleTextureID, vertexbuffer, uvbuffer, normalbuffer);
+			for (const std::pair<size_t, size_t>& pair : static_pairs) {
+				if (static_objects[pair.second]->SphereShape()) {
+					bool hit = (pair_hits[batch / 64] >> (batch % 64)) & 1;
+					++batch;
+					if (!hit) {
+						continue;
+					}
+				}
+				contact_pairs.push_back(std::make_pair(uint32_t(pair.first), uint32_t(objects.size() + pair.second)));
 			}
-		}
 
-		glUseProgram(programID);
+			// Pair tests run in jobs and only collect contacts, one buffer per thread. Sorted by
+			// (obj, other) and applied in one pass, they give the same result for any thread count.
+			auto object_at = [&](uint32_t id) {
+				return id < objects.size() ? objects[id] : static_objects[id - objects.size()];
+			};
 
-		glUniformMatrix4fv(ProjectionID, 1, GL_FALSE, &Projection[0][0]);
-		glUniformMatrix4fv(ViewID, 1, GL_FALSE, &View[0][0]);
+			for (std::vector<Contact>& buffer : contact_buffers) {
+				buffer.clear();
+			}
+			jobs.ParallelFor(0, contact_pairs.size(), job_grain, [&](size_t p) {
+				std::vector<Contact>& buffer = contact_buffers[JobSystem::ThreadIndex()];
+				uint32_t a = contact_pairs[p].first;
+				uint32_t b = contact_pairs[p].second;
+				Contact contact{ a, b, 0.0f, false };
+				if (Interract(object_at(a), object_at(b), contact)) {
+					buffer.push_back(contact);
+				}
+				contact = Contact{ b, a, 0.0f, false };
+				if (Interract(object_at(b), object_at(a), contact)) {
+					buffer.push_back(contact);
+				}
+			});
 
-		std::vector<Object*> projectiles;
+			contacts.clear();
+			for (const std::vector<Contact>& buffer : contact_buffers) {
+				contacts.insert(contacts.end(), buffer.begin(), buffer.end());
+			}
+			std::sort(contacts.begin(), contacts.end());
 
-		for (Object* obj : objects) {
-			Projectile* proj = dynamic_cast<Projectile*>(obj);
-			if ((proj != nullptr) && !proj->Exploded()) {
-				projectiles.push_back(proj);
+			for (const Contact& contact : contacts) {
+				if (contact.obj < objects.size()) {
+					size_t i = contact.obj;
+					remains[i] = remains[i] && Resolve(objects[i], contact, old_positions[i]);
+				}
+				else {
+					size_t k = contact.obj - objects.size();
+					static_remains[k] = static_remains[k] && Resolve(static_objects[k], contact, static_objects[k]->Position());
+				}
+			}
+
+			if (!remains[0]) {
+				player_died = true;
+				break;
 			}
+
+			world.Refit(old_positions);
+			world.RemoveDead(remains, static_remains, on_remove);
 		}
 
-		std::vector<glm::vec3> pos;
-		std::vector<glm::vec3> light_colors;
-		std::vector<float> powers;
+		if (player_died) {
+			break;
+		}
 
-		for (Object* proj : projectiles) {
-			pos.push_back(proj->Position());
-			light_colors.push_back(glm::vec3(1.0f, 0.3f, 0.3f));
-			powers.push_back(proj->Box() * 1000.0f);
+		// The flow field is built on a worker whenever the player enters another cell or a
+		// static collider comes or goes. It is taken over a fixed number of ticks after asking,
+		// waiting for it if need be, so the enemies see the same field in every run.
+		if (pending_flow.valid() && tick >= flow_due) {
+			flow = pending_flow.get();
+			world.SetFlow(&flow);
+		}
+		int cell_x;
+		int cell_z;
+		FlowField::CellOf(player->Position(), flow_cell, cell_x, cell_z);
+		if (!pending_flow.valid() &&
+			(!flow_requested || cell_x != flow_x || cell_z != flow_z || world.StaticVersion() != flow_statics)) {
+			obstacles.clear();
+			for (Object* obj : world.static_objects) {
+				if (obj->SphereShape()) {
+					obstacles.push_back(FlowObstacle{ obj->Position(), obj->Box() + flow_agent_radius });
+				}
+			}
+			pending_flow = FlowField::BuildAsync(player->Position(), obstacles, flow_size, flow_cell, flow_margin);
+			flow_due = tick + flow_latency;
+			flow_x = cell_x;
+			flow_z = cell_z;
+			flow_statics = world.StaticVersion();
+			flow_requested = true;
 		}
 
-		int num = std::min(pos.size(), size_t(ShaderNum));
+		// The player reads input, so it acts here, the rest act in jobs. Every object only
+		// changes itself and leaves spawns and removals in the command buffer, which is
+		// applied in one go once all have acted. The creator comes after every object.
+		{
+			CommandWriter writer = commands.Writer(0);
+			objects[0]->Act(world, writer);
+		}
 
-		if (num > 0) {
-			glUniform1iv(NumID, 1, &num);
-			glUniform3fv(LightID, num, &pos[0][0]);
-			glUniform3fv(LightColorID, num, &light_colors[0][0]);
-			glUniform1fv(LightPowerID, num, &powers[0]);
-		} else {
-			glUniform1iv(NumID, 1, &num);
+		// Enemies think at a rate set by their distance and whether the player looks their
+		// way, in between they keep their course. Updates left out by the budget go first next tick.
+		glm::vec3 eye = player->Position();
+		glm::vec3 view = player->CameraDirection();
+		GLfloat half_view = std::atan(std::tan(glm::radians(player->FOV()) * 0.5f) * GLfloat(w) / GLfloat(h));
+		GLfloat view_cos = std::cos(half_view);
+
+		thinkers.clear();
+		due.clear();
+		for (size_t i = 1; i < objects.size(); ++i) {
+			if (!HasAi(objects[i]->Type())) {
+				continue;
+			}
+			Enemy* enemy = static_cast<Enemy*>(objects[i]);
+			glm::vec3 offset = enemy->Position() - eye;
+			GLfloat distance = glm::length(offset);
+			bool visible = glm::dot(offset, view) >= distance * view_cos;
+			int period = ai.Period(distance, visible);
+			ai.Count(period);
+			if (enemy->ThinkPending()) {
+				thinkers.push_back(i);
+			}
+			else if (AiScheduler::Due(tick, AiScheduler::Phase(enemy->GetHandle().index), period)) {
+				due.push_back(i);
+			}
+		}
+		thinkers.insert(thinkers.end(), due.begin(), due.end());
+
+		size_t deferred = 0;
+		size_t allowed = ai.Allowed();
+		if (thinkers.size() > allowed) {
+			deferred = thinkers.size() - allowed;
+			for (size_t k = allowed; k < thinkers.size(); ++k) {
+				static_cast<Enemy*>(objects[thinkers[k]])->SetThinkPending();
+			}
+			thinkers.resize(allowed);
 		}
 
-		glm::vec3 light = glm::vec3(0.5f, 0.5f, 0.5f);
-		glUniform3fv(SpecularID, 1, &light[0]);
-		light = glm::vec3(0.3f, 0.3f, 0.3f);
-		glUniform3fv(AmbientID, 1, &light[0]);
+		std::chrono::steady_clock::time_point ai_start = std::chrono::steady_clock::now();
+		world.PrepareQueries();
+		jobs.ParallelFor(0, thinkers.size(), job_grain, [&](size_t k) {
+			CommandWriter writer = commands.Writer(uint32_t(thinkers[k]));
+			objects[thinkers[k]]->Act(world, writer);
+		});
+		std::chrono::duration<double> ai_time = std::chrono::steady_clock::now() - ai_start;
+		ai.EndTick(thinkers.size(), deferred, ai_time.count());
+
+		// Every enemy steers clear of the others and of static colliders, so crowds spread
+		// out instead of piling into contacts. Each writes only its own direction.
+		crowd.Clear();
+		crowd_agents.clear();
+		for (size_t i = 1; i < objects.size(); ++i) {
+			if (HasAi(objects[i]->Type())) {
+				crowd.Push(objects[i]->Position(), objects[i]->Box(), 1.0f);
+				crowd_agents.push_back(i);
+			}
+		}
+		for (Object* obj : world.static_objects) {
+			if (obj->SphereShape()) {
+				crowd.Push(obj->Position(), obj->Box(), obstacle_weight);
+			}
+		}
+		crowd_grid.Build(crowd, crowd_spacing);
+		jobs.ParallelFor(0, crowd_agents.size(), job_grain, [&](size_t k) {
+			Enemy* enemy = static_cast<Enemy*>(objects[crowd_agents[k]]);
+			enemy->Steer(crowd_grid.Separation(enemy->Position(), enemy->Box()));
+		});
 
-		for (Object* obj : objects) {
-			if (dynamic_cast<Projectile*>(obj) == nullptr) {
-				glm::mat4 Scale = glm::scale(glm::mat4(), glm::vec3(obj->Box(), obj->Box(), obj->Box()) / 1.5f);
-				glm::mat4 Translate = glm::translate(glm::mat4(), obj->Position());
+		CommandWriter creator_writer = commands.Writer(uint32_t(objects.size()));
+		enemy_creator.CreateEnemy(player->Position(), world, director, creator_writer);
+
+		world.Apply(commands, on_remove);
+
+		// Everything the frame shows is copied into the snapshot, the render thread never sees the world.
+		FrameSnapshot& snapshot = renderer.Snapshots().WriteBuffer();
 
-				glm::vec3 direction = obj->GetDirection();
-				glm::vec3 base_direction(1.0f, 0.0f, 0.0f);
-				glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-				GLfloat sin_value = glm::dot(glm::cross(base_direction, direction), up);
-				GLfloat cos_value = glm::dot(base_direction, direction);
+		snapshot.projection = glm::perspective(glm::radians(player->FOV()), GLfloat(w / h), player->Box(), 300.0f);
+		snapshot.eye = player->Position();
+		snapshot.previous_eye = player->PreviousPosition();
+		snapshot.look = player->CameraDirection();
+		snapshot.previous_look = previous_look;
+		snapshot.up = player->CameraUp();
+
+		glm::mat4 Scale = glm::scale(glm::mat4(), glm::vec3(skybox->Box(), skybox->Box(), skybox->Box()));
+		glm::mat4 Translate = glm::translate(glm::mat4(), skybox->Position());
 
-				glm::mat4 Rotate = glm::rotate(glm::mat4(), std::atan2(sin_value, cos_value), up);
+		snapshot.items.clear();
+		// The skybox is centered on the camera, so it moves along with it.
+		snapshot.items.push_back(RenderItem{ Translate * Scale, skybox->Position(), player->PreviousPosition(),
+			skybox->GetMesh(), false, 0.0f });
+
+		// Model matrices are built in jobs.
+		drawn.clear();
+		world.ForEach([&](Object* obj) {
+			drawn.push_back(obj);
+		});
+		models.resize(drawn.size());
+		jobs.ParallelFor(0, drawn.size(), job_grain, [&](size_t i) {
+			models[i] = ModelMatrix(drawn[i]);
+		});
+
+		for (size_t i = 0; i < drawn.size(); ++i) {
+			Object* obj = drawn[i];
+			if (obj->Type() == ObjectType::Projectile) {
+				GLfloat move = static_cast<Projectile*>(obj)->ExplodedMove();
+				snapshot.items.push_back(RenderItem{ models[i], obj->Position(), obj->PreviousPosition(),
+					obj->GetMesh(), false, move });
+			}
+			else {
+				snapshot.items.push_back(RenderItem{ models[i], obj->Position(), obj->PreviousPosition(),
+					obj->GetMesh(), true, 0.0f });
+			}
+		}
 
-				glm::mat4 Model = Translate * Rotate * Scale;
-				glUniformMatrix4fv(ModelID, 1, GL_FALSE, &Model[0][0]);
+		snapshot.light_positions.clear();
+		snapshot.light_previous_positions.clear();
+		snapshot.light_colors.clear();
+		snapshot.light_powers.clear();
 
-				obj->Draw(TextureID, vertexbuffer, uvbuffer, normalbuffer);
+		for (Object* obj : objects) {
+			if (obj->Type() == ObjectType::Projectile && !static_cast<Projectile*>(obj)->Exploded()) {
+				snapshot.light_positions.push_back(obj->Position());
+				snapshot.light_previous_positions.push_back(obj->PreviousPosition());
+				snapshot.light_colors.push_back(glm::vec3(1.0f, 0.3f, 0.3f));
+				snapshot.light_powers.push_back(obj->Box() * 1000.0f);
 			}
 		}
 
 		size_t current_enemies = 0;
 
-		for (Object* obj : objects) {
-			if (dynamic_cast<Dummy*>(obj) != nullptr || dynamic_cast<Enemy*>(obj) != nullptr) {
+		world.ForEach([&](Object* obj) {
+			if (IsEnemy(obj->Type())) {
 				++current_enemies;
 			}
+		});
+
+		snapshot.hp = player->HP();
+		snapshot.killed = player->Killed();
+		snapshot.enemies = current_enemies;
+
+		std::chrono::steady_clock::time_point rewind_start = std::chrono::steady_clock::now();
+		CaptureRecords(world, rewind_records);
+		rewind_ring.Push(game_time, rewind_records.data(), rewind_records.size() * sizeof(ObjectRecord));
+		rewind_push_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - rewind_start).count();
+
+		std::chrono::duration<double> tick_time = std::chrono::steady_clock::now() - tick_start;
+		snapshot.tick = ++tick;
+		snapshot.tick_ms = GLfloat(tick_time.count() * 1000.0);
+		snapshot.substeps = substeps;
+		snapshot.tick_interval = tick_length / timespeed;
+		snapshot.published = std::chrono::steady_clock::now();
+		renderer.Snapshots().Publish();
+		renderer.AddTickTime(tick_time.count());
+		governor.EndTick();
+		director.Measure(tick_time.count(), renderer.DrawTime(), world.Size(), tick_length);
+
+		if (!headless) {
+			glfwPollEvents();
+		}
+	}
+	while (headless || (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
+		glfwWindowShouldClose(window) == 0));
+
+	if (!headless) {
+		renderer.Stop();
+	}
+	std::chrono::duration<double> session_time = std::chrono::steady_clock::now() - session_start;
+
+	printf("seed: %u\n", seed);
+	if (!replay.empty()) {
+		printf("replay: %llu ticks of %s in %.2f s, %.0f ticks per second\n", (unsigned long long)tick, replay.c_str(),
+			session_time.count(), tick / session_time.count());
+	}
+	if (!record.empty()) {
+		if (input_log.Save(record)) {
+			printf("recorded %llu ticks to %s\n", (unsigned long long)input_log.Size(), record.c_str());
+		}
+		else {
+			printf("Impossible to write %s\n", record.c_str());
 		}
+	}
 
-		printText2D(std::string("HP: " + std::to_string(player->HP())).data(), 10, 550, 20);
-		printText2D(std::string("Killed: " + std::to_string(player->Killed())).data(), 10, 530, 20);
-		printText2D(std::string("Current enemies: " + std::to_string(current_enemies)).data(), 10, 510, 20);
+	printf("simulation: %llu ticks at %.0f per second, %.2f s dropped catching up\n",
+		(unsigned long long)tick, tick_rate, dropped_time);
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	const GovernorStats& steps = governor.Stats();
+	if (steps.ticks > 0) {
+		printf("steps: %.2f substeps per tick, %d at most, %llu ticks stepped coarser, %llu of %llu frames over budget\n",
+			double(steps.substeps) / steps.ticks, steps.max_substeps, (unsigned long long)steps.limited,
+			(unsigned long long)steps.overruns, (unsigned long long)steps.frames);
+	}
 
+	const AiStats& ai_stats = ai.Stats();
+	uint64_t agent_ticks = 0;
+	for (uint64_t count : ai_stats.periods) {
+		agent_ticks += count;
+	}
+	if (ai_stats.ticks > 0 && agent_ticks > 0) {
+		printf("ai: %.1f updates per tick for %.1f enemies, %llu deferred by budget, %.3f ms per tick\n",
+			double(ai_stats.updates) / ai_stats.ticks, double(agent_ticks) / ai_stats.ticks,
+			(unsigned long long)ai_stats.deferred, ai_stats.seconds / ai_stats.ticks * 1000.0);
+		printf("ai periods: %.0f%% every tick, %.0f%% every 2nd, %.0f%% every 4th, %.0f%% every 8th\n",
+			100.0 * ai_stats.periods[0] / agent_ticks, 100.0 * ai_stats.periods[1] / agent_ticks,
+			100.0 * ai_stats.periods[2] / agent_ticks, 100.0 * ai_stats.periods[3] / agent_ticks);
 	}
-	while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
-		glfwWindowShouldClose(window) == 0);
 
-	for (Object* obj : objects) {
-		delete obj;
+	const DirectorStats& spawning = director.Stats();
+	if (spawning.measures > 0 && director.Scripted()) {
+		printf("spawning: scripted waves, %.0f%% of ticks over budget\n", 100.0 * spawning.throttled / spawning.measures);
+	}
+	else if (spawning.measures > 0) {
+		printf("spawning: rate x%.2f now, x%.2f to x%.2f, %.0f%% of ticks throttled, %.0f%% boosted, %llu capped\n",
+			director.Rate(), spawning.rate_min, spawning.rate_max, 100.0 * spawning.throttled / spawning.measures,
+			100.0 * spawning.boosted / spawning.measures, (unsigned long long)spawning.capped);
 	}
 
-	delete skybox;
+	if (snapshots > 0) {
+		save_writer.Wait();
+		SaveWriterStats saving = save_writer.Stats();
+		printf("saves: %llu taken, %.2f ms average and %.2f ms max on the game thread, %llu written, %llu superseded, %llu failed\n",
+			(unsigned long long)snapshots, snapshot_seconds / snapshots * 1000.0, snapshot_max * 1000.0,
+			(unsigned long long)saving.written, (unsigned long long)saving.superseded, (unsigned long long)saving.failed);
+		if (saving.written > 0) {
+			printf("last save: %.1f KB in %.2f ms\n", saving.last_bytes / 1024.0, saving.last_seconds * 1000.0);
+		}
+	}
+
+	const SnapshotRingStats& rewinding = rewind_ring.Stats();
+	if (rewinding.pushed > 0) {
+		printf("rewind: %.1f MB for %.1f s, %llu keyframes evicted, %.3f ms per tick\n",
+			rewind_ring.Bytes() / 1048576.0, rewind_ring.Empty() ? 0.0 : game_time - rewind_ring.Oldest(),
+			(unsigned long long)rewinding.evicted, rewind_push_seconds / rewinding.pushed * 1000.0);
+	}
+	if (rewinding.rewinds > 0) {
+		printf("rewinds: %llu, %.3f ms average and %.3f ms max to restore\n", (unsigned long long)rewinding.rewinds,
+			rewind_restore_seconds / rewinding.rewinds * 1000.0, rewind_restore_max * 1000.0);
+	}
+
+	const RenderStats& stats = renderer.Stats();
+	if (stats.frames > 0 && stats.snapshots > 0) {
+		printf("render: %llu frames, %llu snapshots shown, %llu skipped\n",
+			(unsigned long long)stats.frames, (unsigned long long)stats.snapshots, (unsigned long long)stats.skipped);
+		printf("latency: %.2f ms average, %.2f ms max\n",
+			stats.latency_sum / stats.snapshots * 1000.0, stats.latency_max * 1000.0);
+		printf("drawing: %.2f ms per frame, %.0f%% of it next to a tick\n",
+			stats.busy / stats.frames * 1000.0, stats.busy > 0.0 ? stats.overlap / stats.busy * 100.0 : 0.0);
+	}
 
-	cleanupText2D();
-	glDeleteBuffers(1, &vertexbuffer);
-	glDeleteBuffers(1, &uvbuffer);
-	glDeleteBuffers(1, &normalbuffer);
-	glDeleteProgram(programID);
-	glDeleteProgram(simpleProgramID);
-	glDeleteVertexArrays(1, &VertexArrayID);
+	world.Clear();
+
+	delete skybox;
 
 	glfwTerminate();
 